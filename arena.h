@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Monotonic bump allocator: memory is handed out from large chunks and only ever returned
+// all at once, by `Reset()` or the destructor. Nothing is destroyed automatically.
+class Arena {
+public:
+    explicit Arena(size_t chunk_size = 4096) : chunk_size_(chunk_size) {
+    }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        Release();
+    }
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        char* res = Align(cur_, alignment);
+        if (!head_ || res + size > end_) {
+            AddChunk(size + alignment);
+            res = Align(cur_, alignment);
+        }
+        cur_ = res + size;
+        used_ += size;
+        return res;
+    }
+
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Forget every allocation but keep the most recent chunk for reuse
+    void Reset() {
+        if (!head_) {
+            return;
+        }
+        Chunk* keep = head_;
+        head_ = head_->next;
+        Release();
+        keep->next = nullptr;
+        head_ = keep;
+        cur_ = reinterpret_cast<char*>(keep + 1);
+        end_ = reinterpret_cast<char*>(keep) + keep->size;
+    }
+
+    // Give every chunk back to the heap
+    void Release() {
+        while (head_) {
+            Chunk* next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+        cur_ = end_ = nullptr;
+        used_ = 0;
+    }
+
+    size_t BytesUsed() const {
+        return used_;
+    }
+
+private:
+    struct alignas(std::max_align_t) Chunk {
+        Chunk* next;
+        size_t size;
+    };
+
+    static char* Align(char* ptr, size_t alignment) {
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        return reinterpret_cast<char*>((addr + alignment - 1) & ~(alignment - 1));
+    }
+
+    void AddChunk(size_t min_size) {
+        size_t size = sizeof(Chunk) + (min_size > chunk_size_ ? min_size : chunk_size_);
+        auto chunk = static_cast<Chunk*>(::operator new(size));
+        chunk->next = head_;
+        chunk->size = size;
+        head_ = chunk;
+        cur_ = reinterpret_cast<char*>(chunk + 1);
+        end_ = reinterpret_cast<char*>(chunk) + size;
+    }
+
+    Chunk* head_ = nullptr;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    size_t chunk_size_;
+    size_t used_ = 0;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Tiny timing helper for the hidden `[.bench]` test cases: run them with `<test binary> [.bench]`
+template <typename F>
+double MeasureSeconds(F&& func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+inline void ReportBench(const std::string& name, double seconds) {
+    std::cout << std::left << std::setw(48) << name << std::fixed << std::setprecision(3)
+              << seconds * 1000 << " ms" << std::endl;
+}
+
+// Keeps the optimizer from throwing away benchmarked work
+template <typename T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "shared.h"
+#include "unique.h"
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+// Copy-on-write handle: copies share one object, and the first write through a shared handle
+// clones it. A handle that is the sole owner, with no weak references either, writes in place.
+// The weak reference an `EnableSharedFromThis` object keeps to itself does not count.
+//
+// A reference returned by `Write()` is only good until the handle is copied again. Clones are
+// made as `T`, so `T` can't be polymorphic: a `Derived` behind a `CowPtr<Base>` would be sliced.
+template <typename T>
+class CowPtr {
+    static_assert(!std::is_polymorphic_v<T>, "CowPtr would slice the clones of a Derived");
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    CowPtr() {
+    }
+    explicit CowPtr(SharedPtr<T> ptr) : ptr_(std::move(ptr)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Needs an object to write to
+    T& Write() {
+        assert(ptr_ && "Write() through an empty CowPtr");
+        if (!IsUnique()) {
+            ptr_ = MakeShared<T>(std::as_const(*ptr_));
+        }
+        return *ptr_;
+    }
+    void Reset() {
+        ptr_.Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const T& Read() const {
+        return *ptr_;
+    }
+    const T& operator*() const {
+        return *ptr_;
+    }
+    const T* operator->() const {
+        return ptr_.Get();
+    }
+    const T* Get() const {
+        return ptr_.Get();
+    }
+    size_t UseCount() const {
+        return ptr_.UseCount();
+    }
+    // Sole owner and no weak references, which could `Lock()` a shared version later
+    bool IsUnique() const {
+        return ptr_.UseCount() == 1 && ptr_.block_->weak_ == SelfWeak();
+    }
+    explicit operator bool() const {
+        return ptr_.Get() != nullptr;
+    }
+
+    // Read-only owner of the current version
+    SharedPtr<const T> Share() const {
+        return ptr_;
+    }
+
+private:
+    // 1 if the object is an `EnableSharedFromThis` pointing back at its own block
+    int SelfWeak() const {
+        if constexpr (std::is_base_of_v<WhoAmI, T>) {
+            return ptr_->wptr_.block_ == ptr_.block_ ? 1 : 0;
+        }
+        return 0;
+    }
+
+    SharedPtr<T> ptr_;
+};
+
+template <typename T, typename... Args>
+CowPtr<T> MakeCow(Args&&... args) {
+    return CowPtr<T>(MakeShared<T>(std::forward<Args>(args)...));
+}
+
+// Move the object out of `ptr` if it is the sole owner; otherwise leave `ptr` alone and return
+// an empty `UniquePtr`. What is moved is `*ptr` as a `T`: for an aliasing `ptr` that is just the
+// aliased member, and the rest of the owned object is destroyed.
+template <typename T>
+UniquePtr<T> TryUnwrap(SharedPtr<T>&& ptr) {
+    static_assert(!std::is_polymorphic_v<T>, "TryUnwrap would slice a Derived");
+    if (ptr.UseCount() != 1) {
+        return UniquePtr<T>();
+    }
+    UniquePtr<T> res(new T(std::move(*ptr)));
+    ptr.Reset();
+    return res;
+}
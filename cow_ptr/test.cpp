@@ -0,0 +1,148 @@
+#include "../shared.h"
+#include "../cow_ptr.h"
+#include "../weak.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("CowPtr") {
+    SECTION("Shared reads") {
+        auto a = MakeCow<std::string>("aba");
+        auto b = a;
+        REQUIRE(a.Get() == b.Get());
+        REQUIRE(a.UseCount() == 2);
+        REQUIRE(*b == "aba");
+        REQUIRE(b->size() == 3);
+    }
+
+    SECTION("Clones on shared write") {
+        auto a = MakeCow<std::string>("aba");
+        auto b = a;
+        b.Write() += "caba";
+
+        REQUIRE(a.Read() == "aba");
+        REQUIRE(b.Read() == "abacaba");
+        REQUIRE(a.IsUnique());
+        REQUIRE(b.IsUnique());
+    }
+
+    SECTION("Writes in place when unique") {
+        auto a = MakeCow<std::vector<int>>(3, 1);
+        const std::vector<int>* before = a.Get();
+        a.Write().push_back(2);
+        REQUIRE(a.Get() == before);
+        REQUIRE(a->size() == 4);
+    }
+
+    SECTION("Share") {
+        auto a = MakeCow<std::string>("aba");
+        SharedPtr<const std::string> snapshot = a.Share();
+        a.Write() = "caba";
+        REQUIRE(*snapshot == "aba");
+        REQUIRE(*a == "caba");
+    }
+
+    SECTION("Weak reference to a shared version") {
+        auto a = MakeCow<std::string>("aba");
+        WeakPtr<const std::string> weak(a.Share());
+        REQUIRE(a.UseCount() == 1);
+        REQUIRE(!a.IsUnique());
+
+        a.Write() = "caba";
+        REQUIRE(weak.Expired());
+        REQUIRE(a.IsUnique());
+        a.Write() += "!";
+        REQUIRE(*a == "caba!");
+    }
+
+    SECTION("EnableSharedFromThis writes in place when unique") {
+        struct Doc : EnableSharedFromThis<Doc> {
+            std::string text;
+        };
+        auto a = MakeCow<Doc>();
+        const Doc* before = a.Get();
+        REQUIRE(a.IsUnique());
+        a.Write().text = "aba";
+        REQUIRE(a.Get() == before);
+
+        WeakPtr<const Doc> weak = a->WeakFromThis();
+        REQUIRE(!a.IsUnique());
+        a.Write().text += "caba";
+        REQUIRE(a.Get() != before);
+        REQUIRE(a.IsUnique());
+        REQUIRE(a->text == "abacaba");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TryUnwrap") {
+    SECTION("Sole owner") {
+        auto ptr = MakeShared<std::string>("abacaba");
+        WeakPtr<std::string> weak(ptr);
+        auto unique = TryUnwrap(std::move(ptr));
+
+        REQUIRE(unique);
+        REQUIRE(*unique == "abacaba");
+        REQUIRE(!ptr);
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Shared") {
+        auto ptr = MakeShared<std::string>("aba");
+        auto other = ptr;
+        auto unique = TryUnwrap(std::move(ptr));
+
+        REQUIRE(!unique);
+        REQUIRE(ptr.UseCount() == 2);
+        REQUIRE(*ptr == "aba");
+    }
+
+    SECTION("Empty") {
+        REQUIRE(!TryUnwrap(SharedPtr<int>()));
+    }
+
+    SECTION("Aliased member") {
+        struct Pair {
+            std::string first;
+            std::string second;
+        };
+        auto pair = MakeShared<Pair>(Pair{"aba", "caba"});
+        WeakPtr<Pair> weak(pair);
+        SharedPtr<std::string> second(pair, &pair->second);
+        pair.Reset();
+
+        auto unique = TryUnwrap(std::move(second));
+        REQUIRE(*unique == "caba");
+        REQUIRE(weak.Expired());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("CowPtr vs defensive copies", "[.bench]") {
+    constexpr int kEdits = 1 << 12;
+    const std::vector<int> document(1 << 14, 1);
+
+    ReportBench("defensive copy per edit", MeasureSeconds([&] {
+                    auto shared = MakeShared<std::vector<int>>(document);
+                    for (int i = 0; i < kEdits; ++i) {
+                        auto copy = MakeShared<std::vector<int>>(*shared);
+                        (*copy)[i] = i;
+                        shared = copy;
+                    }
+                    DoNotOptimize(shared.Get());
+                }));
+    ReportBench("CowPtr edits", MeasureSeconds([&] {
+                    auto cow = MakeCow<std::vector<int>>(document);
+                    for (int i = 0; i < kEdits; ++i) {
+                        cow.Write()[i] = i;
+                    }
+                    DoNotOptimize(cow.Get());
+                }));
+}
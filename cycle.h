@@ -0,0 +1,354 @@
+#pragma once
+
+#include "shared.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Trial-deletion cycle collection in the style of Bacon and Rajan, "Concurrent Cycle Collection
+// in Reference Counted Systems" (the synchronous variant).
+//
+// Opt in per type with a `void Trace(CycleVisitor& visitor)` member that calls `visitor(edge)`
+// for every `SharedPtr` member, and create objects with `MakeTraced`. Dropping a reference that
+// is not the last one, whatever the static type of the owner or the way it is released, buffers
+// the block as a candidate root; `CycleCollector::Collect()` then finds the candidates that are
+// only kept alive by each other and destroys them.
+//
+// Objects made by `MakeShared` or `new` are never collected; edges to them count as external
+// references, which is always safe.
+
+class BlockCollectable;
+
+// Passed to `T::Trace`: either enumerates collectable children or clears the edges
+class CycleVisitor {
+public:
+    // Clears every edge it is applied to
+    CycleVisitor() {
+    }
+    CycleVisitor(void (*visit)(BlockCollectable*, void*), void* ctx) : visit_(visit), ctx_(ctx) {
+    }
+
+    template <typename U>
+    void operator()(SharedPtr<U>& edge);
+
+private:
+    void (*visit_)(BlockCollectable*, void*) = nullptr;
+    void* ctx_ = nullptr;
+};
+
+// Types that expose their `SharedPtr` edges to the cycle collector
+template <typename T>
+concept Traceable = requires(T& object, CycleVisitor& visitor) { object.Trace(visitor); };
+
+// Control block of a collectable object: colors and root buffer state of the algorithm
+class BlockCollectable : public BlockBase {
+public:
+    enum class Color : uint8_t { kBlack, kGray, kWhite, kPurple };
+
+    BlockCollectable() {
+        traced_ = 1;
+    }
+
+    void Suspect() override;
+
+    virtual void TraceEdges(CycleVisitor& visitor) = 0;
+    // Block and object size, for reclamation reports
+    virtual size_t Bytes() const = 0;
+
+    Color color_ = Color::kBlack;
+    bool buffered_ = false;
+};
+
+template <typename T>
+class BlockTraced : public BlockCollectable {
+public:
+    template <class... Args>
+    BlockTraced(Args&&... args) {
+        new (&data_) T(std::forward<Args>(args)...);
+    }
+
+    void Destruct() override {
+        GetPtr()->~T();
+    }
+    void TraceEdges(CycleVisitor& visitor) override {
+        GetPtr()->Trace(visitor);
+    }
+    size_t Bytes() const override {
+        return sizeof(BlockTraced);
+    }
+    T* GetPtr() {
+        return reinterpret_cast<T*>(&data_);
+    }
+
+    std::aligned_storage_t<sizeof(T), alignof(T)> data_;
+};
+
+template <typename U>
+void CycleVisitor::operator()(SharedPtr<U>& edge) {
+    if (!visit_) {
+        edge.Reset();
+        return;
+    }
+    if (auto block = dynamic_cast<BlockCollectable*>(edge.block_)) {
+        visit_(block, ctx_);
+    }
+}
+
+struct CycleStats {
+    size_t objects = 0;
+    size_t bytes = 0;
+    // Candidate roots left for the next `Collect()`
+    size_t pending = 0;
+};
+
+// Root buffer and collection phases. Counters are not atomic, so there is one collector per
+// thread and collectable objects must be released on the thread that created them. Objects
+// released after the thread's collector is destroyed (later in thread exit, or during static
+// destruction on the main thread) are not buffered any more: cycles dropped then are leaked.
+class CycleCollector {
+public:
+    static CycleCollector& Local() {
+        thread_local CycleCollector collector;
+        return collector;
+    }
+    // `Local()`, or null once it has been destroyed
+    static CycleCollector* LocalIfAlive() {
+        return destroyed_ ? nullptr : &Local();
+    }
+
+    CycleCollector() {
+    }
+    CycleCollector(const CycleCollector&) = delete;
+    CycleCollector& operator=(const CycleCollector&) = delete;
+
+    ~CycleCollector() {
+        destroyed_ = true;
+        for (auto block : roots_) {
+            block->buffered_ = false;
+            Unpin(block);
+        }
+    }
+
+    // Buffered blocks hold a weak reference, so a root that dies meanwhile stays readable
+    void PossibleRoot(BlockCollectable* block) {
+        if (block->color_ == BlockCollectable::Color::kWhite) {
+            return;
+        }
+        block->color_ = BlockCollectable::Color::kPurple;
+        if (!block->buffered_) {
+            block->buffered_ = true;
+            block->AddWeak();
+            roots_.push_back(block);
+        }
+    }
+
+    // Process candidate roots in batches until none are left or `max_seconds` have passed
+    CycleStats Collect(double max_seconds = std::numeric_limits<double>::infinity()) {
+        auto start = std::chrono::steady_clock::now();
+        CycleStats stats;
+        std::vector<BlockCollectable*> batch;
+        while (!roots_.empty()) {
+            size_t count = roots_.size() < kBatch ? roots_.size() : kBatch;
+            batch.assign(roots_.end() - count, roots_.end());
+            roots_.resize(roots_.size() - count);
+            CollectBatch(batch, stats);
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= max_seconds) {
+                break;
+            }
+        }
+        stats.pending = roots_.size();
+        total_.objects += stats.objects;
+        total_.bytes += stats.bytes;
+        return stats;
+    }
+
+    size_t Roots() const {
+        return roots_.size();
+    }
+    // Everything reclaimed by this collector so far
+    const CycleStats& Total() const {
+        return total_;
+    }
+
+private:
+    using Color = BlockCollectable::Color;
+
+    static constexpr size_t kBatch = 256;
+
+    template <typename F>
+    static void ForEachChild(BlockCollectable* block, F&& func) {
+        using Func = std::remove_reference_t<F>;
+        CycleVisitor visitor(
+            [](BlockCollectable* child, void* ctx) { (*static_cast<Func*>(ctx))(child); },
+            &func);
+        block->TraceEdges(visitor);
+    }
+
+    static void Unpin(BlockCollectable* block) {
+        block->weak_--;
+        if (block->weak_ + block->strong_ == 0) {
+            block->Deallocate();
+        }
+    }
+
+    void CollectBatch(std::vector<BlockCollectable*>& batch, CycleStats& stats) {
+        // Mark roots: subtract the counts contributed by edges inside each candidate subgraph
+        // Roots that are dead or already reached keep their pin until the counts are restored
+        std::vector<BlockCollectable*> dropped;
+        size_t live = 0;
+        for (auto block : batch) {
+            block->buffered_ = false;
+            if (block->color_ == Color::kPurple && block->strong_ > 0) {
+                MarkGray(block);
+                batch[live++] = block;
+            } else {
+                if (block->color_ == Color::kPurple) {
+                    block->color_ = Color::kBlack;
+                }
+                dropped.push_back(block);
+            }
+        }
+        batch.resize(live);
+
+        // Scan: anything still referenced from outside is live, and so is what it reaches
+        for (auto block : batch) {
+            Scan(block);
+        }
+
+        // Collect white: the rest is garbage
+        std::vector<BlockCollectable*> white;
+        for (auto block : batch) {
+            CollectWhite(block, white);
+        }
+        FreeWhite(white, stats);
+        for (auto block : batch) {
+            Unpin(block);
+        }
+        for (auto block : dropped) {
+            Unpin(block);
+        }
+    }
+
+    void MarkGray(BlockCollectable* root) {
+        stack_.push_back(root);
+        while (!stack_.empty()) {
+            auto block = stack_.back();
+            stack_.pop_back();
+            if (block->color_ == Color::kGray) {
+                continue;
+            }
+            block->color_ = Color::kGray;
+            ForEachChild(block, [this](BlockCollectable* child) {
+                child->strong_--;
+                stack_.push_back(child);
+            });
+        }
+    }
+
+    void Scan(BlockCollectable* root) {
+        stack_.push_back(root);
+        while (!stack_.empty()) {
+            auto block = stack_.back();
+            stack_.pop_back();
+            if (block->color_ != Color::kGray) {
+                continue;
+            }
+            if (block->strong_ > 0) {
+                ScanBlack(block);
+                continue;
+            }
+            block->color_ = Color::kWhite;
+            ForEachChild(block, [this](BlockCollectable* child) { stack_.push_back(child); });
+        }
+    }
+
+    // Restore the counts subtracted by `MarkGray` below a live block
+    void ScanBlack(BlockCollectable* root) {
+        size_t bottom = black_.size();
+        root->color_ = Color::kBlack;
+        black_.push_back(root);
+        while (black_.size() > bottom) {
+            auto block = black_.back();
+            black_.pop_back();
+            ForEachChild(block, [this](BlockCollectable* child) {
+                child->strong_++;
+                if (child->color_ != Color::kBlack) {
+                    child->color_ = Color::kBlack;
+                    black_.push_back(child);
+                }
+            });
+        }
+    }
+
+    void CollectWhite(BlockCollectable* root, std::vector<BlockCollectable*>& white) {
+        stack_.push_back(root);
+        while (!stack_.empty()) {
+            auto block = stack_.back();
+            stack_.pop_back();
+            if (block->color_ != Color::kWhite) {
+                continue;
+            }
+            block->color_ = Color::kBlack;
+            block->AddWeak();
+            white.push_back(block);
+            ForEachChild(block, [this](BlockCollectable* child) { stack_.push_back(child); });
+        }
+    }
+
+    void FreeWhite(std::vector<BlockCollectable*>& white, CycleStats& stats) {
+        // Give every edge its count back, so that clearing the edges balances out
+        for (auto block : white) {
+            block->color_ = Color::kWhite;
+            ForEachChild(block, [](BlockCollectable* child) { child->strong_++; });
+        }
+        // An extra reference on each object keeps the whole cycle alive while it is cut
+        CycleVisitor clear;
+        for (auto block : white) {
+            block->strong_++;
+        }
+        for (auto block : white) {
+            block->TraceEdges(clear);
+        }
+        for (auto block : white) {
+            stats.objects++;
+            stats.bytes += block->Bytes();
+            block->ReleaseStrong();
+        }
+        for (auto block : white) {
+            Unpin(block);
+        }
+    }
+
+    // Trivially destructible, so it stays readable for the whole thread exit
+    static inline thread_local bool destroyed_ = false;
+
+    std::vector<BlockCollectable*> roots_;
+    std::vector<BlockCollectable*> stack_;
+    std::vector<BlockCollectable*> black_;
+    CycleStats total_;
+};
+
+inline void BlockCollectable::Suspect() {
+    if (auto collector = CycleCollector::LocalIfAlive()) {
+        collector->PossibleRoot(this);
+    }
+}
+
+// `MakeShared` for objects the cycle collector may reclaim
+template <typename T, typename... Args>
+SharedPtr<T> MakeTraced(Args&&... args) {
+    static_assert(Traceable<T>, "MakeTraced needs T::Trace(CycleVisitor&)");
+    SharedPtr<T> res;
+    auto block = new BlockTraced<T>(std::forward<Args>(args)...);
+    res.block_ = block;
+    res.ptr_ = block->GetPtr();
+    res.EnableThis(res.ptr_);
+    return res;
+}
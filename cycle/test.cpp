@@ -0,0 +1,233 @@
+#include "../shared.h"
+#include "../weak.h"
+#include "../cycle.h"
+#include "../shared_batch.h"
+#include "../soft_cache.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Base without `Trace`, for owners that don't know they hold a collectable object
+struct Tagged {};
+
+struct Node : Tagged {
+    static inline int alive = 0;
+
+    explicit Node(int id = 0) : id(id) {
+        ++alive;
+    }
+    ~Node() {
+        --alive;
+    }
+
+    void Trace(CycleVisitor& visitor) {
+        for (auto& edge : edges) {
+            visitor(edge);
+        }
+    }
+
+    int id;
+    std::vector<SharedPtr<Node>> edges;
+    SharedPtr<int> payload;
+};
+
+// Ring of `n` collectable nodes; the caller holds node 0
+SharedPtr<Node> MakeRing(int n) {
+    auto head = MakeTraced<Node>(0);
+    auto prev = head;
+    for (int i = 1; i < n; ++i) {
+        auto node = MakeTraced<Node>(i);
+        prev->edges.push_back(node);
+        prev = node;
+    }
+    prev->edges.push_back(head);
+    return head;
+}
+
+}  // namespace
+
+TEST_CASE("CycleCollector") {
+    auto& collector = CycleCollector::Local();
+    collector.Collect();
+    Node::alive = 0;
+
+    SECTION("Two-node cycle") {
+        WeakPtr<Node> weak;
+        {
+            auto a = MakeTraced<Node>(1);
+            auto b = MakeTraced<Node>(2);
+            a->edges.push_back(b);
+            b->edges.push_back(a);
+            weak = a;
+        }
+        REQUIRE(Node::alive == 2);
+        REQUIRE(collector.Roots() > 0);
+
+        auto stats = collector.Collect();
+        REQUIRE(Node::alive == 0);
+        REQUIRE(stats.objects == 2);
+        REQUIRE(stats.bytes == 2 * sizeof(BlockTraced<Node>));
+        REQUIRE(weak.Expired());
+        REQUIRE(collector.Roots() == 0);
+    }
+
+    SECTION("Self loop") {
+        {
+            auto a = MakeTraced<Node>(1);
+            a->edges.push_back(a);
+        }
+        REQUIRE(collector.Collect().objects == 1);
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Externally held cycles survive") {
+        auto ring = MakeRing(10);
+        auto second = ring->edges[0];
+        ring.Reset();
+        REQUIRE(collector.Collect().objects == 0);
+        REQUIRE(Node::alive == 10);
+        REQUIRE(second.UseCount() == 2);
+        REQUIRE(second->edges[0]->id == 2);
+
+        second.Reset();
+        REQUIRE(collector.Collect().objects == 10);
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Garbage pointing at live objects") {
+        auto live = MakeTraced<Node>(100);
+        auto payload = MakeShared<int>(5);
+        {
+            auto ring = MakeRing(3);
+            ring->edges.push_back(live);
+            ring->payload = payload;
+        }
+        REQUIRE(live.UseCount() == 2);
+        REQUIRE(collector.Collect().objects == 3);
+        REQUIRE(live.UseCount() == 1);
+        REQUIRE(payload.UseCount() == 1);
+        REQUIRE(Node::alive == 1);
+    }
+
+    SECTION("Acyclic garbage is freed by counting alone") {
+        {
+            auto a = MakeTraced<Node>(1);
+            a->edges.push_back(MakeTraced<Node>(2));
+        }
+        REQUIRE(Node::alive == 0);
+        REQUIRE(collector.Collect().objects == 0);
+    }
+
+    SECTION("Long rings do not recurse") {
+        MakeRing(100000);
+        REQUIRE(collector.Collect().objects == 100000);
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Last outside reference dropped through ReleaseBatch") {
+        std::vector<SharedPtr<Node>> batch;
+        batch.push_back(MakeRing(2));
+        batch.push_back(batch.back());
+        REQUIRE(collector.Collect().objects == 0);
+
+        ReleaseBatch(batch);
+        REQUIRE(Node::alive == 2);
+        REQUIRE(collector.Collect().objects == 2);
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Last outside reference dropped by a SoftCache") {
+        {
+            SoftCache cache(100);
+            cache.Add(MakeRing(2), 100);
+            REQUIRE(collector.Collect().objects == 0);
+
+            // Evicted to make room
+            cache.Add(MakeShared<int>(1), 100);
+            REQUIRE(collector.Collect().objects == 2);
+
+            cache.Add(MakeRing(2), 100);
+            REQUIRE(collector.Collect().objects == 0);
+        }
+        // Released by the cache's destructor
+        REQUIRE(Node::alive == 2);
+        REQUIRE(collector.Collect().objects == 2);
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Last outside reference typed as a base without Trace") {
+        SharedPtr<Tagged> owner = MakeRing(2);
+        REQUIRE(collector.Collect().objects == 0);
+
+        owner.Reset();
+        REQUIRE(Node::alive == 2);
+        REQUIRE(collector.Collect().objects == 2);
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Incremental collection") {
+        std::vector<SharedPtr<Node>> rings;
+        for (int i = 0; i < 2000; ++i) {
+            rings.push_back(MakeRing(2));
+            // Drop a non-last reference, so every ring gets buffered
+            auto copy = rings.back();
+        }
+        rings.clear();
+        REQUIRE(collector.Roots() >= 2000);
+
+        auto stats = collector.Collect(0);
+        REQUIRE(stats.pending > 0);
+        REQUIRE(stats.objects > 0);
+        while (collector.Roots() > 0) {
+            collector.Collect(0);
+        }
+        REQUIRE(Node::alive == 0);
+    }
+
+    REQUIRE(collector.Roots() == 0);
+}
+
+TEST_CASE("Releases after the thread's collector is gone") {
+    struct Holder {
+        SharedPtr<Node> first;
+        SharedPtr<Node> second;
+    };
+
+    Node::alive = 0;
+    std::thread([] {
+        // Constructed before the collector, so destroyed after it on thread exit
+        thread_local Holder holder;
+        holder.first = MakeTraced<Node>(1);
+        holder.second = holder.first;
+        {
+            auto copy = holder.first;
+        }
+        REQUIRE(CycleCollector::Local().Roots() == 1);
+        CycleCollector::Local().Collect();
+    }).join();
+    REQUIRE(Node::alive == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("CycleCollector bench", "[.bench]") {
+    constexpr int kRings = 1 << 14;
+    constexpr int kRingSize = 16;
+
+    auto& collector = CycleCollector::Local();
+    for (int i = 0; i < kRings; ++i) {
+        MakeRing(kRingSize);
+    }
+    CycleStats stats;
+    ReportBench("collect rings", MeasureSeconds([&] { stats = collector.Collect(); }));
+    std::cout << "reclaimed " << stats.objects << " objects, " << stats.bytes / 1024 << " KiB"
+              << std::endl;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "shared.h"
+#include "weak.h"
+
+#include <cassert>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Expiration callbacks: `func(ctx, block)` runs once, right after the object of `block` is
+// destroyed, while the block is still pinned, so a callback may drop weak references to it.
+// Callbacks live in a side table keyed by block and the block only gets its `hooked_` bit set,
+// so blocks that never get one stay as small as before and pay one bit check on release.
+//
+// Like the counters themselves, none of this is thread-safe: the table is shared by all
+// blocks, so registering, cancelling and releasing hooked blocks must not race with each other.
+
+using ExpireFunc = void (*)(void* ctx, BlockBase* block);
+
+class ExpireTable {
+public:
+    static void Add(BlockBase* block, ExpireFunc func, void* ctx) {
+        assert(block->strong_ > 0);
+        BlockBase::fire_expire_ = &ExpireTable::Fire;
+        Hooks& hooks = Table()[block];
+        block->hooked_ = true;
+        if (!hooks.first.func) {
+            hooks.first = {func, ctx};
+        } else {
+            hooks.more.push_back({func, ctx});
+        }
+    }
+    // Unregister one callback added with the same `func` and `ctx`
+    static bool Cancel(BlockBase* block, ExpireFunc func, void* ctx) {
+        if (!block->hooked_) {
+            return false;
+        }
+        auto it = Table().find(block);
+        Hooks& hooks = it->second;
+        auto& more = hooks.more;
+        if (hooks.first.func == func && hooks.first.ctx == ctx) {
+            if (more.empty()) {
+                // Keep the entry only while it holds a callback
+                Table().erase(it);
+                block->hooked_ = false;
+            } else {
+                hooks.first = more.back();
+                more.pop_back();
+            }
+            return true;
+        }
+        for (size_t i = 0; i < more.size(); ++i) {
+            if (more[i].func == func && more[i].ctx == ctx) {
+                more[i] = more.back();
+                more.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Number of blocks with callbacks
+    static size_t Size() {
+        return Table().size();
+    }
+
+private:
+    struct Hook {
+        ExpireFunc func;
+        void* ctx;
+    };
+    // The first callback of a block is stored inline, the rest go to `more`
+    struct Hooks {
+        Hook first = {nullptr, nullptr};
+        std::vector<Hook> more;
+    };
+
+    // Never destroyed, so blocks released during static destruction can still reach it
+    static std::unordered_map<const BlockBase*, Hooks>& Table() {
+        static auto table = new std::unordered_map<const BlockBase*, Hooks>();
+        return *table;
+    }
+
+    static void Fire(BlockBase* block) {
+        // Detached first: callbacks may cancel, register or drop other pointers re-entrantly
+        auto it = Table().find(block);
+        Hooks hooks = std::move(it->second);
+        Table().erase(it);
+        block->hooked_ = false;
+        hooks.first.func(hooks.first.ctx, block);
+        for (auto& hook : hooks.more) {
+            hook.func(hook.ctx, block);
+        }
+    }
+};
+
+// Call `func(ctx, block)` when the last strong reference to `block` is gone
+inline void OnExpire(BlockBase* block, ExpireFunc func, void* ctx) {
+    ExpireTable::Add(block, func, ctx);
+}
+inline bool CancelOnExpire(BlockBase* block, ExpireFunc func, void* ctx) {
+    return ExpireTable::Cancel(block, func, ctx);
+}
+
+// Register `func(ctx, weak.block_)` to run when the object expires; false if it already has
+template <typename T>
+bool OnExpire(const WeakPtr<T>& weak, ExpireFunc func, void* ctx) {
+    if (weak.Expired()) {
+        return false;
+    }
+    ExpireTable::Add(weak.block_, func, ctx);
+    return true;
+}
+template <typename T>
+bool CancelOnExpire(const WeakPtr<T>& weak, ExpireFunc func, void* ctx) {
+    return weak.block_ && ExpireTable::Cancel(weak.block_, func, ctx);
+}
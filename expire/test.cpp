@@ -0,0 +1,199 @@
+#include "../expire.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+void Count(void* ctx, BlockBase*) {
+    ++*static_cast<int*>(ctx);
+}
+
+void Log(void* ctx, BlockBase*) {
+    static_cast<std::vector<int>*>(ctx)->push_back(1);
+}
+
+// Weak-keyed cache that drops its dead entries exactly once instead of sweeping
+class WeakCache {
+public:
+    void Put(const std::string& key, const SharedPtr<std::string>& value) {
+        WeakPtr<std::string> weak(value);
+        OnExpire(weak, &WeakCache::Erase, this);
+        keys_[weak.block_] = key;
+        entries_[key] = weak;
+    }
+    SharedPtr<std::string> Get(const std::string& key) const {
+        auto it = entries_.find(key);
+        return it == entries_.end() ? SharedPtr<std::string>() : it->second.Lock();
+    }
+    size_t Size() const {
+        return entries_.size();
+    }
+
+private:
+    static void Erase(void* ctx, BlockBase* block) {
+        auto self = static_cast<WeakCache*>(ctx);
+        auto it = self->keys_.find(block);
+        self->entries_.erase(it->second);
+        self->keys_.erase(it);
+    }
+
+    std::unordered_map<std::string, WeakPtr<std::string>> entries_;
+    std::unordered_map<BlockBase*, std::string> keys_;
+};
+
+}  // namespace
+
+TEST_CASE("OnExpire") {
+    SECTION("Fires once when the last strong reference is gone") {
+        int fired = 0;
+        auto a = MakeShared<int>(1);
+        WeakPtr<int> weak(a);
+        REQUIRE(OnExpire(weak, &Count, &fired));
+
+        auto b = a;
+        a.Reset();
+        REQUIRE(fired == 0);
+        b.Reset();
+        REQUIRE(fired == 1);
+        REQUIRE(weak.Expired());
+        REQUIRE(!OnExpire(weak, &Count, &fired));
+    }
+
+    SECTION("Inline slot and overflow list") {
+        int fired = 0;
+        std::vector<int> log;
+        auto ptr = MakeShared<int>(1);
+        WeakPtr<int> weak(ptr);
+        for (int i = 0; i < 5; ++i) {
+            OnExpire(weak, &Count, &fired);
+        }
+        OnExpire(weak, &Log, &log);
+        ptr.Reset();
+        REQUIRE(fired == 5);
+        REQUIRE(log.size() == 1);
+    }
+
+    SECTION("Cancel") {
+        int fired = 0;
+        int other = 0;
+        auto ptr = MakeShared<int>(1);
+        WeakPtr<int> weak(ptr);
+        OnExpire(weak, &Count, &fired);
+        OnExpire(weak, &Count, &other);
+
+        REQUIRE(CancelOnExpire(weak, &Count, &fired));
+        REQUIRE(!CancelOnExpire(weak, &Count, &fired));
+        REQUIRE(CancelOnExpire(weak, &Count, &other));
+        OnExpire(weak, &Count, &other);
+        ptr.Reset();
+        REQUIRE(fired == 0);
+        REQUIRE(other == 1);
+    }
+
+    SECTION("Plain blocks pay nothing") {
+        struct PlainBlock {
+            virtual ~PlainBlock() = default;
+            int strong;
+            int weak;
+        };
+        STATIC_REQUIRE(sizeof(BlockBase) == sizeof(PlainBlock));
+
+        int fired = 0;
+        auto ptr = MakeShared<int>(1);
+        REQUIRE(!ptr.block_->hooked_);
+        WeakPtr<int> weak(ptr);
+        OnExpire(weak, &Count, &fired);
+        REQUIRE(ptr.block_->hooked_);
+        REQUIRE(CancelOnExpire(weak, &Count, &fired));
+        REQUIRE(!ptr.block_->hooked_);
+        ptr.Reset();
+        REQUIRE(fired == 0);
+    }
+
+    SECTION("Entries leave the table once empty") {
+        int fired = 0;
+        int other = 0;
+        auto ptr = MakeShared<int>(1);
+        WeakPtr<int> weak(ptr);
+        size_t size = ExpireTable::Size();
+        OnExpire(weak, &Count, &fired);
+        OnExpire(weak, &Count, &other);
+        REQUIRE(ExpireTable::Size() == size + 1);
+
+        REQUIRE(CancelOnExpire(weak, &Count, &fired));
+        REQUIRE(ptr.block_->hooked_);
+        REQUIRE(CancelOnExpire(weak, &Count, &other));
+        REQUIRE(!ptr.block_->hooked_);
+        REQUIRE(ExpireTable::Size() == size);
+
+        OnExpire(weak, &Count, &fired);
+        ptr.Reset();
+        REQUIRE(fired == 1);
+        REQUIRE(ExpireTable::Size() == size);
+    }
+
+    SECTION("Callback may drop the last weak reference") {
+        struct Holder {
+            WeakPtr<int> weak;
+            int fired = 0;
+        } holder;
+
+        auto ptr = MakeShared<int>(1);
+        holder.weak = ptr;
+        OnExpire(
+            holder.weak,
+            [](void* ctx, BlockBase*) {
+                auto holder = static_cast<Holder*>(ctx);
+                holder->weak.Reset();
+                ++holder->fired;
+            },
+            &holder);
+        ptr.Reset();
+        REQUIRE(holder.fired == 1);
+        REQUIRE(holder.weak.block_ == nullptr);
+    }
+
+    SECTION("Weak-keyed cache without sweeps") {
+        WeakCache cache;
+        auto a = MakeShared<std::string>("aba");
+        auto b = MakeShared<std::string>("caba");
+        cache.Put("a", a);
+        cache.Put("b", b);
+        REQUIRE(cache.Size() == 2);
+        REQUIRE(*cache.Get("a") == "aba");
+
+        a.Reset();
+        REQUIRE(cache.Size() == 1);
+        REQUIRE(!cache.Get("a"));
+        b.Reset();
+        REQUIRE(cache.Size() == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("OnExpire bench", "[.bench]") {
+    constexpr int kCount = 1 << 20;
+    int fired = 0;
+
+    ReportBench("MakeShared + Reset", MeasureSeconds([&] {
+        for (int i = 0; i < kCount; ++i) {
+            auto ptr = MakeShared<int>(i);
+            DoNotOptimize(ptr.Get());
+        }
+    }));
+    ReportBench("MakeShared + OnExpire + Reset", MeasureSeconds([&] {
+        for (int i = 0; i < kCount; ++i) {
+            auto ptr = MakeShared<int>(i);
+            OnExpire(ptr.block_, &Count, &fired);
+        }
+    }));
+    REQUIRE(fired == kCount);
+}
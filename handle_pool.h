@@ -0,0 +1,193 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Weak-style reference into a `HandlePool`: a slot index and the generation of the object that
+// lived there when the handle was made. Generation 0 is never used, so `Handle()` is null.
+struct Handle {
+    uint32_t index = 0;
+    uint32_t generation = 0;
+
+    explicit operator bool() const {
+        return generation != 0;
+    }
+};
+
+inline bool operator==(Handle left, Handle right) {
+    return left.index == right.index && left.generation == right.generation;
+}
+
+// Objects stored in dense chunks of slots with stable addresses. A slot is reused after
+// `Destroy()` with a bumped generation, which makes every old handle to it dangle
+// detectably: `Get()` is two array lookups and a compare, with no counters touched.
+//
+// `Lock()` gives real ownership through the aliasing constructor: the `SharedPtr` shares the
+// count of the whole chunk. While a chunk is locked, `Destroy()` only invalidates handles and
+// defers the destructor until the chunk is unlocked and the pool needs slots (or `Collect()`
+// is called). Objects still locked when the pool dies live as long as their chunk.
+template <typename T>
+class HandlePool {
+    static constexpr uint32_t kChunkBits = 10;
+    static constexpr uint32_t kChunkSize = 1u << kChunkBits;
+
+    enum class State : uint8_t { kFree, kAlive, kDeferred };
+
+    struct Slot {
+        std::aligned_storage_t<sizeof(T), alignof(T)> data;
+        uint32_t generation = 1;
+        State state = State::kFree;
+
+        T* GetPtr() {
+            return reinterpret_cast<T*>(&data);
+        }
+    };
+
+    struct Chunk {
+        ~Chunk() {
+            for (auto& slot : slots) {
+                if (slot.state != State::kFree) {
+                    slot.GetPtr()->~T();
+                }
+            }
+        }
+
+        Slot slots[kChunkSize];
+        std::vector<uint32_t> deferred;
+    };
+
+public:
+    HandlePool() {
+    }
+    HandlePool(const HandlePool&) = delete;
+    HandlePool& operator=(const HandlePool&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    template <typename... Args>
+    Handle Create(Args&&... args) {
+        if (free_.empty() && deferred_ > 0) {
+            Collect();
+        }
+        uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            // Room for every slot of the pool, this chunk included, before the chunk exists: a
+            // failed growth can't strand its slots, and no later `free_.push_back` (below or in
+            // `Free`) can throw
+            free_.reserve((chunks_.size() + 1) * kChunkSize);
+            index = static_cast<uint32_t>(chunks_.size()) << kChunkBits;
+            chunks_.push_back(MakeShared<Chunk>());
+            for (uint32_t i = kChunkSize - 1; i > 0; --i) {
+                free_.push_back(index + i);
+            }
+        }
+
+        Slot& slot = At(index);
+        try {
+            new (&slot.data) T(std::forward<Args>(args)...);
+        } catch (...) {
+            free_.push_back(index);
+            throw;
+        }
+        slot.state = State::kAlive;
+        size_++;
+        return {index, slot.generation};
+    }
+
+    // Destroy the object behind `handle`; false if it is already gone
+    bool Destroy(Handle handle) {
+        if (!Get(handle)) {
+            return false;
+        }
+        Slot& slot = At(handle.index);
+        auto& chunk = chunks_[handle.index >> kChunkBits];
+        bool locked = chunk.UseCount() > 1;
+        if (locked) {
+            // The only step that can throw, so it goes before the slot changes
+            chunk->deferred.push_back(handle.index);
+        }
+        if (++slot.generation == 0) {
+            slot.generation = 1;
+        }
+        size_--;
+
+        if (locked) {
+            slot.state = State::kDeferred;
+            deferred_++;
+        } else {
+            Free(slot, handle.index);
+        }
+        return true;
+    }
+
+    // Run the destructors deferred by `Destroy()` in chunks that are no longer locked
+    void Collect() {
+        for (auto& chunk : chunks_) {
+            if (chunk->deferred.empty() || chunk.UseCount() > 1) {
+                continue;
+            }
+            for (uint32_t index : chunk->deferred) {
+                Free(At(index), index);
+            }
+            deferred_ -= chunk->deferred.size();
+            chunk->deferred.clear();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // The object behind `handle`, or `nullptr` if it was destroyed
+    T* Get(Handle handle) const {
+        uint32_t chunk = handle.index >> kChunkBits;
+        if (chunk >= chunks_.size()) {
+            return nullptr;
+        }
+        Slot& slot = chunks_[chunk]->slots[handle.index & (kChunkSize - 1)];
+        if (slot.generation != handle.generation || slot.state != State::kAlive) {
+            return nullptr;
+        }
+        return slot.GetPtr();
+    }
+    SharedPtr<T> Lock(Handle handle) const {
+        T* ptr = Get(handle);
+        if (!ptr) {
+            return SharedPtr<T>();
+        }
+        return SharedPtr<T>(chunks_[handle.index >> kChunkBits], ptr);
+    }
+
+    // Live objects
+    size_t Size() const {
+        return size_;
+    }
+    size_t Capacity() const {
+        return chunks_.size() * kChunkSize;
+    }
+
+private:
+    Slot& At(uint32_t index) const {
+        return chunks_[index >> kChunkBits]->slots[index & (kChunkSize - 1)];
+    }
+
+    // Can't throw: `free_` always has room for every slot
+    void Free(Slot& slot, uint32_t index) {
+        slot.GetPtr()->~T();
+        slot.state = State::kFree;
+        free_.push_back(index);
+    }
+
+    std::vector<SharedPtr<Chunk>> chunks_;
+    std::vector<uint32_t> free_;
+    size_t size_ = 0;
+    size_t deferred_ = 0;
+};
@@ -0,0 +1,165 @@
+#include "../shared.h"
+#include "../weak.h"
+#include "../handle_pool.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Entity {
+    static inline int alive = 0;
+
+    explicit Entity(int id) : id(id) {
+        if (id < 0) {
+            throw std::invalid_argument("Entity: negative id");
+        }
+        ++alive;
+    }
+    ~Entity() {
+        --alive;
+    }
+
+    int id;
+    float position[3] = {};
+};
+
+}  // namespace
+
+TEST_CASE("HandlePool") {
+    Entity::alive = 0;
+
+    SECTION("Create and Get") {
+        HandlePool<std::string> pool;
+        auto a = pool.Create("aba");
+        auto b = pool.Create(3, 'c');
+
+        REQUIRE(*pool.Get(a) == "aba");
+        REQUIRE(*pool.Get(b) == "ccc");
+        REQUIRE(pool.Size() == 2);
+        REQUIRE(!pool.Get(Handle()));
+        REQUIRE(sizeof(Handle) == 8);
+    }
+
+    SECTION("Destroyed handles dangle detectably") {
+        HandlePool<Entity> pool;
+        auto a = pool.Create(1);
+        REQUIRE(pool.Destroy(a));
+        REQUIRE(!pool.Destroy(a));
+        REQUIRE(!pool.Get(a));
+        REQUIRE(Entity::alive == 0);
+
+        // The slot is reused with a new generation
+        auto b = pool.Create(2);
+        REQUIRE(b.index == a.index);
+        REQUIRE(!pool.Get(a));
+        REQUIRE(pool.Get(b)->id == 2);
+    }
+
+    SECTION("Addresses are stable") {
+        HandlePool<Entity> pool;
+        auto first = pool.Create(0);
+        Entity* ptr = pool.Get(first);
+        for (int i = 1; i < 5000; ++i) {
+            pool.Create(i);
+        }
+        REQUIRE(pool.Get(first) == ptr);
+        REQUIRE(pool.Size() == 5000);
+    }
+
+    SECTION("Throwing constructor gives the slot back") {
+        HandlePool<Entity> pool;
+        REQUIRE_THROWS_AS(pool.Create(-1), std::invalid_argument);
+        auto first = pool.Create(0);
+        REQUIRE_THROWS_AS(pool.Create(-1), std::invalid_argument);
+        REQUIRE(pool.Size() == 1);
+
+        for (size_t i = 1; i < pool.Capacity(); ++i) {
+            pool.Create(static_cast<int>(i));
+        }
+        REQUIRE(pool.Size() == 1024);
+        REQUIRE(pool.Capacity() == 1024);
+        REQUIRE(pool.Get(first)->id == 0);
+    }
+
+    SECTION("Lock defers destruction") {
+        HandlePool<Entity> pool;
+        auto handle = pool.Create(1);
+        auto locked = pool.Lock(handle);
+        REQUIRE(locked->id == 1);
+
+        pool.Destroy(handle);
+        REQUIRE(!pool.Get(handle));
+        REQUIRE(!pool.Lock(handle));
+        REQUIRE(Entity::alive == 1);
+        REQUIRE(locked->id == 1);
+
+        pool.Collect();
+        REQUIRE(Entity::alive == 1);
+        locked.Reset();
+        pool.Collect();
+        REQUIRE(Entity::alive == 0);
+    }
+
+    SECTION("Locked objects outlive the pool") {
+        SharedPtr<Entity> locked;
+        {
+            HandlePool<Entity> pool;
+            locked = pool.Lock(pool.Create(7));
+            pool.Create(8);
+        }
+        REQUIRE(locked->id == 7);
+        REQUIRE(Entity::alive == 2);
+        locked.Reset();
+        REQUIRE(Entity::alive == 0);
+    }
+
+    REQUIRE(Entity::alive == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("HandlePool bench", "[.bench]") {
+    constexpr int kCount = 1 << 18;
+    constexpr int kLookups = 1 << 22;
+
+    std::cout << "bytes per reference: Handle " << sizeof(Handle) << ", WeakPtr "
+              << sizeof(WeakPtr<Entity>) << std::endl;
+    std::cout << "bytes per object: HandlePool slot ~" << sizeof(Entity) + 8
+              << ", MakeShared block " << sizeof(BlockObject<Entity>) << " + malloc header"
+              << std::endl;
+
+    HandlePool<Entity> pool;
+    std::vector<Handle> handles;
+    std::vector<SharedPtr<Entity>> owners;
+    std::vector<WeakPtr<Entity>> weaks;
+    for (int i = 0; i < kCount; ++i) {
+        handles.push_back(pool.Create(i));
+        owners.push_back(MakeShared<Entity>(i));
+        weaks.emplace_back(owners.back());
+    }
+
+    uint32_t state = 1;
+    int64_t sum = 0;
+    ReportBench("HandlePool::Get", MeasureSeconds([&] {
+        for (int i = 0; i < kLookups; ++i) {
+            state = state * 1664525 + 1013904223;
+            sum += pool.Get(handles[state % kCount])->id;
+        }
+    }));
+    ReportBench("WeakPtr::Lock", MeasureSeconds([&] {
+        for (int i = 0; i < kLookups; ++i) {
+            state = state * 1664525 + 1013904223;
+            sum += weaks[state % kCount].Lock()->id;
+        }
+    }));
+    DoNotOptimize(sum);
+}
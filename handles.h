@@ -0,0 +1,47 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <cstdint>
+
+#include <unistd.h>
+
+// Integer handle with a dedicated null value, so it can be used as `Deleter::pointer` and owned
+// by `UniquePtr` without any allocation: `UniquePtr<void, D>` is as big as the integer itself.
+template <typename Int, Int Null>
+class IntHandle {
+public:
+    IntHandle() {
+    }
+    IntHandle(std::nullptr_t) {
+    }
+    explicit IntHandle(Int value) : value_(value) {
+    }
+
+    Int Get() const {
+        return value_;
+    }
+    explicit operator bool() const {
+        return value_ != Null;
+    }
+
+    bool operator==(const IntHandle& other) const = default;
+
+private:
+    Int value_ = Null;
+};
+
+using FdHandle = IntHandle<int, -1>;
+using SlotIndex = IntHandle<uint32_t, UINT32_MAX>;
+
+struct FdDeleter {
+    using pointer = FdHandle;
+
+    void operator()(FdHandle fd) const {
+        close(fd.Get());
+    }
+};
+
+// Owning file descriptor
+using UniqueFd = UniquePtr<void, FdDeleter>;
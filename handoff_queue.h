@@ -0,0 +1,289 @@
+#pragma once
+
+#include "unique.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Queues that move `UniquePtr<T, Deleter>` ownership between threads. Push `Release()`-s the
+// pointer into the queue and pop adopts it into a fresh `UniquePtr` with a value-initialized
+// deleter, so deleters must be stateless and `Pointer` must be `T*`. Null items are dropped on
+// push, since a popped null means "empty". Whatever is still queued when the queue dies is
+// deleted with it.
+
+// Base class for messages that opt into intrusive links: `MpscQueue` then threads them through
+// this hook instead of allocating a node per push. A message can be in one queue at a time.
+struct QueueHook {
+    std::atomic<QueueHook*> queue_next_ = nullptr;
+};
+
+template <typename T>
+concept QueueIntrusive = std::is_base_of_v<QueueHook, T>;
+
+// Unbounded lock-free multi-producer single-consumer queue (Dmitry Vyukov's intrusive design):
+// a push is one `exchange` on the head plus one store. Producers never wait for each other or
+// for the consumer. `Pop()` may see the queue as empty while a producer is between those two
+// steps; the message shows up on a later pop.
+template <typename T, typename Deleter = std::default_delete<T>>
+class MpscQueue {
+    static_assert(std::is_same_v<typename UniquePtr<T, Deleter>::Pointer, T*>);
+    static_assert(std::is_empty_v<Deleter>, "Popped items get a fresh deleter");
+
+    struct Node : QueueHook {
+        T* value;
+    };
+
+public:
+    using Item = UniquePtr<T, Deleter>;
+
+    MpscQueue() {
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        while (Pop()) {
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Producer side, any thread
+
+    void Push(Item&& item) {
+        if (!item) {
+            return;
+        }
+        QueueHook* hook = Link(item);
+        PushChain(hook, hook);
+    }
+    // Publish all `items` with a single `exchange`; they stay contiguous in the queue. If a node
+    // allocation throws, the items linked so far are still published and the rest stay in `items`.
+    void PushBatch(std::vector<Item>& items) {
+        QueueHook* first = nullptr;
+        QueueHook* last = nullptr;
+        size_t linked = 0;
+        try {
+            for (; linked < items.size(); ++linked) {
+                if (!items[linked]) {
+                    continue;
+                }
+                QueueHook* hook = Link(items[linked]);
+                if (last) {
+                    last->queue_next_.store(hook, std::memory_order_relaxed);
+                } else {
+                    first = hook;
+                }
+                last = hook;
+            }
+        } catch (...) {
+            if (first) {
+                PushChain(first, last);
+            }
+            items.erase(items.begin(), items.begin() + linked);
+            throw;
+        }
+        items.clear();
+        if (first) {
+            PushChain(first, last);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Consumer side, one thread
+
+    // Next message, or null if there is none yet
+    Item Pop() {
+        QueueHook* tail = tail_;
+        QueueHook* next = tail->queue_next_.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (!next) {
+                return Item();
+            }
+            tail_ = next;
+            tail = next;
+            next = next->queue_next_.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail_ = next;
+            return Unlink(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return Item();
+        }
+        // `tail` is the last message: put the stub behind it so that it can be handed out
+        stub_.queue_next_.store(nullptr, std::memory_order_relaxed);
+        PushChain(&stub_, &stub_);
+        next = tail->queue_next_.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return Unlink(tail);
+        }
+        return Item();
+    }
+    // Append up to `max` messages to `out`; returns how many were taken
+    size_t PopBatch(std::vector<Item>& out, size_t max) {
+        size_t count = 0;
+        for (; count < max; ++count) {
+            Item item = Pop();
+            if (!item) {
+                break;
+            }
+            out.push_back(std::move(item));
+        }
+        return count;
+    }
+
+private:
+    // Takes `item` only once its node exists, so a throwing allocation leaves it with the caller
+    static QueueHook* Link(Item& item) {
+        QueueHook* hook;
+        if constexpr (QueueIntrusive<T>) {
+            hook = item.Release();
+        } else {
+            auto node = new Node();
+            node->value = item.Release();
+            hook = node;
+        }
+        hook->queue_next_.store(nullptr, std::memory_order_relaxed);
+        return hook;
+    }
+    static Item Unlink(QueueHook* hook) {
+        if constexpr (QueueIntrusive<T>) {
+            return Item(static_cast<T*>(hook));
+        } else {
+            auto node = static_cast<Node*>(hook);
+            T* value = node->value;
+            delete node;
+            return Item(value);
+        }
+    }
+
+    void PushChain(QueueHook* first, QueueHook* last) {
+        QueueHook* prev = head_.exchange(last, std::memory_order_acq_rel);
+        prev->queue_next_.store(first, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<QueueHook*> head_ = &stub_;
+    alignas(64) QueueHook* tail_ = &stub_;
+    QueueHook stub_;
+};
+
+// Bounded lock-free single-producer single-consumer ring of released pointers. Each side keeps
+// a cached copy of the other side's index and only re-reads the shared one when the cache says
+// the ring is full (or empty).
+template <typename T, typename Deleter = std::default_delete<T>>
+class SpscRing {
+    static_assert(std::is_same_v<typename UniquePtr<T, Deleter>::Pointer, T*>);
+    static_assert(std::is_empty_v<Deleter>, "Popped items get a fresh deleter");
+
+public:
+    using Item = UniquePtr<T, Deleter>;
+
+    // `capacity` is rounded up to a power of two
+    explicit SpscRing(size_t capacity = 1024) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        slots_.Reset(new T*[size]());
+    }
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    ~SpscRing() {
+        while (Pop()) {
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Producer side
+
+    // False if the ring is full; `item` keeps its object then
+    bool TryPush(Item&& item) {
+        if (!item) {
+            return true;
+        }
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ > mask_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ > mask_) {
+                return false;
+            }
+        }
+        slots_.Get()[head & mask_] = item.Release();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // Push from the front of `items` while there is room, publishing them with one store.
+    // Returns how many were taken (nulls included); those are removed from `items`.
+    size_t PushBatch(std::vector<Item>& items) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t free = mask_ + 1 - (head - cached_tail_);
+        if (free < items.size()) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            free = mask_ + 1 - (head - cached_tail_);
+        }
+        size_t taken = 0;
+        size_t pushed = 0;
+        for (; taken < items.size(); ++taken) {
+            if (!items[taken]) {
+                continue;
+            }
+            if (pushed == free) {
+                break;
+            }
+            slots_.Get()[(head + pushed++) & mask_] = items[taken].Release();
+        }
+        head_.store(head + pushed, std::memory_order_release);
+        items.erase(items.begin(), items.begin() + taken);
+        return taken;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Consumer side
+
+    Item Pop() {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) {
+                return Item();
+            }
+        }
+        Item res(slots_.Get()[tail & mask_]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return res;
+    }
+    // Append up to `max` messages to `out`, freeing their slots with one store
+    size_t PopBatch(std::vector<Item>& out, size_t max) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (cached_head_ - tail < max) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+        }
+        size_t count = cached_head_ - tail < max ? cached_head_ - tail : max;
+        // Grow `out` up front: a throw midway would leave adopted items in the live range
+        out.reserve(out.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            out.emplace_back(slots_.Get()[(tail + i) & mask_]);
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t Capacity() const {
+        return mask_ + 1;
+    }
+
+private:
+    UniquePtr<T*[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_ = 0;
+    size_t cached_tail_ = 0;
+    alignas(64) std::atomic<size_t> tail_ = 0;
+    size_t cached_head_ = 0;
+};
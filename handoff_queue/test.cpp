@@ -0,0 +1,323 @@
+#include "../unique.h"
+#include "../handoff_queue.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Message {
+    static inline std::atomic<int> alive = 0;
+
+    Message(int producer, int seq) : producer(producer), seq(seq) {
+        ++alive;
+    }
+    ~Message() {
+        --alive;
+    }
+
+    int producer;
+    int seq;
+};
+
+struct LinkedMessage : QueueHook {
+    LinkedMessage(int producer, int seq) : producer(producer), seq(seq) {
+    }
+
+    int producer;
+    int seq;
+};
+
+// Every producer's messages must arrive complete and in order
+template <typename Queue>
+void RunProducers(Queue& queue, int producers, int per_producer, bool batched) {
+    using Item = typename Queue::Item;
+    using T = std::remove_pointer_t<decltype(Item().Get())>;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p, per_producer, batched] {
+            std::vector<Item> batch;
+            for (int i = 0; i < per_producer; ++i) {
+                if (!batched) {
+                    queue.Push(Item(new T(p, i)));
+                    continue;
+                }
+                batch.emplace_back(new T(p, i));
+                if (batch.size() == 16 || i + 1 == per_producer) {
+                    queue.PushBatch(batch);
+                }
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    std::vector<Item> popped;
+    int received = 0;
+    while (received < producers * per_producer) {
+        popped.clear();
+        if (!queue.PopBatch(popped, 64)) {
+            std::this_thread::yield();
+        }
+        for (auto& item : popped) {
+            REQUIRE(item->seq == next[item->producer]);
+            ++next[item->producer];
+            ++received;
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(!queue.Pop());
+}
+
+}  // namespace
+
+TEST_CASE("MpscQueue") {
+    SECTION("FIFO with node allocation") {
+        MpscQueue<Message> queue;
+        REQUIRE(!queue.Pop());
+        for (int i = 0; i < 5; ++i) {
+            queue.Push(UniquePtr<Message>(new Message(0, i)));
+        }
+        for (int i = 0; i < 5; ++i) {
+            auto item = queue.Pop();
+            REQUIRE(item->seq == i);
+        }
+        REQUIRE(!queue.Pop());
+        REQUIRE(Message::alive == 0);
+    }
+
+    SECTION("Intrusive links") {
+        MpscQueue<LinkedMessage> queue;
+        UniquePtr<LinkedMessage> first(new LinkedMessage(0, 1));
+        LinkedMessage* raw = first.Get();
+        queue.Push(std::move(first));
+        REQUIRE(!first);
+        REQUIRE(raw->queue_next_.load() == nullptr);
+
+        auto popped = queue.Pop();
+        REQUIRE(popped.Get() == raw);
+        REQUIRE(!queue.Pop());
+
+        // The same message can go round again
+        queue.Push(std::move(popped));
+        REQUIRE(queue.Pop().Get() == raw);
+    }
+
+    SECTION("Leftovers are deleted with the queue") {
+        {
+            MpscQueue<Message> queue;
+            std::vector<UniquePtr<Message>> batch;
+            for (int i = 0; i < 10; ++i) {
+                batch.emplace_back(new Message(0, i));
+            }
+            queue.PushBatch(batch);
+            REQUIRE(batch.empty());
+            REQUIRE(queue.Pop()->seq == 0);
+        }
+        REQUIRE(Message::alive == 0);
+    }
+
+    SECTION("Null items are dropped") {
+        MpscQueue<LinkedMessage> queue;
+        queue.Push(UniquePtr<LinkedMessage>());
+        REQUIRE(!queue.Pop());
+
+        std::vector<UniquePtr<LinkedMessage>> batch;
+        batch.emplace_back();
+        batch.emplace_back(new LinkedMessage(0, 1));
+        batch.emplace_back();
+        batch.emplace_back(new LinkedMessage(0, 2));
+        queue.PushBatch(batch);
+        REQUIRE(batch.empty());
+
+        std::vector<UniquePtr<LinkedMessage>> out;
+        REQUIRE(queue.PopBatch(out, 10) == 2);
+        REQUIRE(out[1]->seq == 2);
+    }
+
+    SECTION("Many producers") {
+        MpscQueue<Message> queue;
+        RunProducers(queue, 4, 20000, false);
+        MpscQueue<LinkedMessage> linked;
+        RunProducers(linked, 4, 20000, true);
+        REQUIRE(Message::alive == 0);
+    }
+}
+
+TEST_CASE("SpscRing") {
+    SECTION("Full ring keeps the item") {
+        SpscRing<Message> ring(3);
+        REQUIRE(ring.Capacity() == 4);
+        for (int i = 0; i < 4; ++i) {
+            REQUIRE(ring.TryPush(UniquePtr<Message>(new Message(0, i))));
+        }
+        UniquePtr<Message> extra(new Message(0, 4));
+        REQUIRE(!ring.TryPush(std::move(extra)));
+        REQUIRE(extra->seq == 4);
+
+        REQUIRE(ring.Pop()->seq == 0);
+        REQUIRE(ring.TryPush(std::move(extra)));
+        REQUIRE(!extra);
+    }
+    REQUIRE(Message::alive == 0);
+
+    SECTION("Batches") {
+        SpscRing<Message> ring(8);
+        std::vector<UniquePtr<Message>> items;
+        for (int i = 0; i < 10; ++i) {
+            items.emplace_back(new Message(0, i));
+        }
+        REQUIRE(ring.PushBatch(items) == 8);
+        REQUIRE(items.size() == 2);
+        REQUIRE(items[0]->seq == 8);
+
+        std::vector<UniquePtr<Message>> out;
+        REQUIRE(ring.PopBatch(out, 5) == 5);
+        REQUIRE(ring.PushBatch(items) == 2);
+        REQUIRE(ring.PopBatch(out, 100) == 5);
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(out[i]->seq == i);
+        }
+    }
+
+    SECTION("Null items are dropped") {
+        SpscRing<Message> ring(2);
+        REQUIRE(ring.TryPush(UniquePtr<Message>()));
+        REQUIRE(!ring.Pop());
+
+        std::vector<UniquePtr<Message>> items;
+        items.emplace_back();
+        items.emplace_back(new Message(0, 1));
+        items.emplace_back();
+        items.emplace_back(new Message(0, 2));
+        items.emplace_back(new Message(0, 3));
+        REQUIRE(ring.PushBatch(items) == 4);
+        REQUIRE(items.size() == 1);
+        REQUIRE(items[0]->seq == 3);
+
+        std::vector<UniquePtr<Message>> out;
+        REQUIRE(ring.PopBatch(out, 10) == 2);
+        REQUIRE(out[0]->seq == 1);
+        REQUIRE(out[1]->seq == 2);
+    }
+
+    SECTION("Two threads") {
+        constexpr int kCount = 100000;
+        SpscRing<Message> ring(64);
+        std::thread producer([&ring] {
+            for (int i = 0; i < kCount; ++i) {
+                UniquePtr<Message> item(new Message(0, i));
+                while (!ring.TryPush(std::move(item))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        for (int i = 0; i < kCount;) {
+            if (auto item = ring.Pop()) {
+                REQUIRE(item->seq == i);
+                ++i;
+            }
+        }
+        producer.join();
+    }
+    REQUIRE(Message::alive == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// What the pipeline used before
+template <typename T>
+class LockedQueue {
+public:
+    using Item = UniquePtr<T>;
+
+    void Push(Item&& item) {
+        std::lock_guard lock(mutex_);
+        queue_.push(std::move(item));
+    }
+    void PushBatch(std::vector<Item>& items) {
+        std::lock_guard lock(mutex_);
+        for (auto& item : items) {
+            queue_.push(std::move(item));
+        }
+        items.clear();
+    }
+    size_t PopBatch(std::vector<Item>& out, size_t max) {
+        std::lock_guard lock(mutex_);
+        size_t count = 0;
+        for (; count < max && !queue_.empty(); ++count) {
+            out.push_back(std::move(queue_.front()));
+            queue_.pop();
+        }
+        return count;
+    }
+    Item Pop() {
+        std::lock_guard lock(mutex_);
+        if (queue_.empty()) {
+            return Item();
+        }
+        Item res = std::move(queue_.front());
+        queue_.pop();
+        return res;
+    }
+
+private:
+    std::mutex mutex_;
+    std::queue<Item> queue_;
+};
+
+}  // namespace
+
+TEST_CASE("Handoff queue bench", "[.bench]") {
+    constexpr int kMessages = 1 << 20;
+
+    for (int producers : {1, 2, 4, 8}) {
+        auto suffix = " x" + std::to_string(producers);
+        ReportBench("mutex + std::queue" + suffix, MeasureSeconds([&] {
+            LockedQueue<Message> queue;
+            RunProducers(queue, producers, kMessages / producers, false);
+        }));
+        ReportBench("MpscQueue" + suffix, MeasureSeconds([&] {
+            MpscQueue<Message> queue;
+            RunProducers(queue, producers, kMessages / producers, false);
+        }));
+        ReportBench("MpscQueue intrusive, batched" + suffix, MeasureSeconds([&] {
+            MpscQueue<LinkedMessage> queue;
+            RunProducers(queue, producers, kMessages / producers, true);
+        }));
+    }
+
+    ReportBench("SpscRing", MeasureSeconds([&] {
+        SpscRing<Message> ring(1024);
+        std::thread producer([&ring] {
+            for (int i = 0; i < kMessages; ++i) {
+                UniquePtr<Message> item(new Message(0, i));
+                while (!ring.TryPush(std::move(item))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        std::vector<UniquePtr<Message>> out;
+        for (int received = 0; received < kMessages;) {
+            out.clear();
+            if (size_t count = ring.PopBatch(out, 64)) {
+                received += count;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+    }));
+}
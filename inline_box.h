@@ -0,0 +1,172 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Operations on an object stored inside an `InlineBox`, captured when it was created
+template <typename Base>
+struct InlineOps {
+    // Move-construct the object from `from` into `to`, destroy the source and return the new
+    // object's `Base` subobject
+    Base* (*relocate)(void* from, void* to);
+    void (*destroy)(void* object);
+    // Move the object to the heap, destroy the source
+    Base* (*to_heap)(void* object);
+};
+
+template <typename Base, typename Derived>
+inline constexpr InlineOps<Base> kInlineOps = {
+    [](void* from, void* to) -> Base* {
+        auto source = static_cast<Derived*>(from);
+        Base* res = new (to) Derived(std::move(*source));
+        source->~Derived();
+        return res;
+    },
+    [](void* object) { static_cast<Derived*>(object)->~Derived(); },
+    [](void* object) -> Base* {
+        auto source = static_cast<Derived*>(object);
+        Base* res = new Derived(std::move(*source));
+        source->~Derived();
+        return res;
+    },
+};
+
+// Owning box with `UniquePtr` semantics that keeps small objects (up to `N` bytes) inside
+// itself instead of on the heap. Bigger objects, over-aligned ones, objects that may throw on
+// move and anything adopted from a `UniquePtr` live on the heap as usual.
+template <typename Base, size_t N = 48>
+class InlineBox {
+public:
+    template <typename Derived>
+    static constexpr bool kFitsInline = sizeof(Derived) <= N &&
+                                        alignof(Derived) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<Derived>;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    InlineBox() {
+    }
+    InlineBox(std::nullptr_t) {
+    }
+    InlineBox(UniquePtr<Base>&& owner) : ptr_(owner.Release()) {
+    }
+    template <typename Derived>
+    InlineBox(UniquePtr<Derived>&& owner) : ptr_(owner.Release()) {
+    }
+
+    InlineBox(InlineBox&& other) noexcept {
+        MoveFrom(other);
+    }
+    InlineBox(const InlineBox&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    InlineBox& operator=(InlineBox&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+
+        Reset();
+        MoveFrom(other);
+
+        return *this;
+    }
+    InlineBox& operator=(const InlineBox&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~InlineBox() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    template <typename Derived, typename... Args>
+    Derived& Emplace(Args&&... args) {
+        static_assert(std::is_base_of_v<Base, Derived>);
+        Reset();
+        Derived* object;
+        if constexpr (kFitsInline<Derived>) {
+            object = new (&storage_) Derived(std::forward<Args>(args)...);
+            ops_ = &kInlineOps<Base, Derived>;
+        } else {
+            object = new Derived(std::forward<Args>(args)...);
+        }
+        ptr_ = object;
+        return *object;
+    }
+
+    void Reset() {
+        if (ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        } else {
+            delete ptr_;
+        }
+        ptr_ = nullptr;
+    }
+
+    // Hand the object over to a `UniquePtr`, moving it to the heap if it is stored inline
+    UniquePtr<Base> ToUnique() && {
+        Base* res = ptr_;
+        if (ops_) {
+            res = ops_->to_heap(&storage_);
+            ops_ = nullptr;
+        }
+        ptr_ = nullptr;
+        return UniquePtr<Base>(res);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    Base* Get() const {
+        return ptr_;
+    }
+    Base& operator*() const {
+        return *ptr_;
+    }
+    Base* operator->() const {
+        return ptr_;
+    }
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+    bool IsInline() const {
+        return ops_ != nullptr;
+    }
+
+private:
+    void MoveFrom(InlineBox& other) {
+        if (other.ops_) {
+            ptr_ = other.ops_->relocate(&other.storage_, &storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        } else {
+            ptr_ = other.ptr_;
+        }
+        other.ptr_ = nullptr;
+    }
+
+    // Points into `storage_` or to the heap
+    Base* ptr_ = nullptr;
+    // Null for heap objects
+    const InlineOps<Base>* ops_ = nullptr;
+    alignas(std::max_align_t) std::byte storage_[N];
+};
+
+template <typename Base, typename Derived, size_t N = 48, typename... Args>
+InlineBox<Base, N> MakeInlineBox(Args&&... args) {
+    InlineBox<Base, N> res;
+    res.template Emplace<Derived>(std::forward<Args>(args)...);
+    return res;
+}
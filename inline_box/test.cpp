@@ -0,0 +1,147 @@
+#include "../unique.h"
+#include "../inline_box.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+#include <allocations_checker.h>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Shape {
+    virtual ~Shape() {
+        --alive;
+    }
+    virtual int Area() const = 0;
+
+    Shape() {
+        ++alive;
+    }
+    Shape(const Shape&) noexcept {
+        ++alive;
+    }
+
+    inline static int alive = 0;
+};
+
+struct Square : Shape {
+    explicit Square(int side) : side(side) {
+    }
+    int Area() const override {
+        return side * side;
+    }
+
+    int side;
+};
+
+struct Named : Shape {
+    explicit Named(std::string name) : name(std::move(name)) {
+    }
+    int Area() const override {
+        return name.size();
+    }
+
+    std::string name;
+};
+
+struct Huge : Shape {
+    int Area() const override {
+        return sizeof(data);
+    }
+
+    char data[256] = {};
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("InlineBox") {
+    SECTION("Small objects stay inline") {
+        InlineBox<Shape> box;
+        EXPECT_ZERO_ALLOCATIONS(box.Emplace<Square>(3));
+        REQUIRE(box.IsInline());
+        REQUIRE(box->Area() == 9);
+        REQUIRE(reinterpret_cast<char*>(box.Get()) >= reinterpret_cast<char*>(&box));
+        REQUIRE(reinterpret_cast<char*>(box.Get()) < reinterpret_cast<char*>(&box + 1));
+    }
+    REQUIRE(Shape::alive == 0);
+
+    SECTION("Big objects go to the heap") {
+        auto box = MakeInlineBox<Shape, Huge>();
+        REQUIRE(!box.IsInline());
+        REQUIRE(box->Area() == 256);
+    }
+    REQUIRE(Shape::alive == 0);
+
+    SECTION("Move") {
+        auto a = MakeInlineBox<Shape, Named>("abacaba");
+        InlineBox<Shape> b(std::move(a));
+        REQUIRE(!a);
+        REQUIRE(b.IsInline());
+        REQUIRE(b->Area() == 7);
+        REQUIRE(Shape::alive == 1);
+
+        auto c = MakeInlineBox<Shape, Huge>();
+        c = std::move(b);
+        REQUIRE(c->Area() == 7);
+        REQUIRE(Shape::alive == 1);
+
+        std::vector<InlineBox<Shape>> boxes;
+        for (int i = 0; i < 100; ++i) {
+            boxes.push_back(MakeInlineBox<Shape, Square>(i));
+        }
+        REQUIRE(boxes[42]->Area() == 42 * 42);
+        REQUIRE(Shape::alive == 101);
+    }
+    REQUIRE(Shape::alive == 0);
+
+    SECTION("Conversions to and from UniquePtr") {
+        InlineBox<Shape> adopted(UniquePtr<Square>(new Square(2)));
+        REQUIRE(!adopted.IsInline());
+        REQUIRE(adopted->Area() == 4);
+
+        auto inline_box = MakeInlineBox<Shape, Square>(5);
+        UniquePtr<Shape> owner = std::move(inline_box).ToUnique();
+        REQUIRE(!inline_box);
+        REQUIRE(owner->Area() == 25);
+
+        UniquePtr<Shape> released = std::move(adopted).ToUnique();
+        REQUIRE(released->Area() == 4);
+        REQUIRE(Shape::alive == 2);
+    }
+    REQUIRE(Shape::alive == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("InlineBox vs UniquePtr", "[.bench]") {
+    constexpr int kCount = 1 << 20;
+
+    int64_t sum = 0;
+    ReportBench("UniquePtr<Shape>", MeasureSeconds([&] {
+                    std::vector<UniquePtr<Shape>> shapes;
+                    shapes.reserve(kCount);
+                    for (int i = 0; i < kCount; ++i) {
+                        shapes.emplace_back(new Square(i % 100));
+                    }
+                    for (const auto& shape : shapes) {
+                        sum += shape->Area();
+                    }
+                }));
+    ReportBench("InlineBox<Shape>", MeasureSeconds([&] {
+                    std::vector<InlineBox<Shape, 16>> shapes;
+                    shapes.reserve(kCount);
+                    for (int i = 0; i < kCount; ++i) {
+                        shapes.emplace_back().Emplace<Square>(i % 100);
+                    }
+                    for (const auto& shape : shapes) {
+                        sum += shape->Area();
+                    }
+                }));
+    DoNotOptimize(sum);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "shared.h"
+#include "weak.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+// `std::hash<T>` unless specialized. A specialization with `is_transparent` lets the table look
+// values up by other key types, so that hits don't have to build a `T` first; the one for
+// `std::string` takes anything convertible to `std::string_view`.
+template <typename T>
+struct InternHash : std::hash<T> {};
+
+template <>
+struct InternHash<std::string> {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view value) const {
+        return std::hash<std::string_view>()(value);
+    }
+};
+
+// Keys an `InternTable<T, Hash>` can look up without building a `T`. Equal keys and values
+// must hash the same.
+template <typename Key, typename T, typename Hash>
+concept InternKey = requires(const Key& key, const T& value) {
+    typename Hash::is_transparent;
+    { Hash()(key) } -> std::convertible_to<size_t>;
+    { value == key } -> std::convertible_to<bool>;
+    requires std::constructible_from<T, const Key&>;
+};
+
+// Hash-consing table: equal values share one canonical object. Entries are `WeakPtr`-s, so
+// the table never keeps a value alive; entries whose block has expired are purged lazily,
+// when a lookup walks past them and in an amortized sweep after enough insertions.
+//
+// Like the counters in `BlockBase`, the table is not synchronized.
+template <typename T, typename Hash = InternHash<T>>
+class InternTable {
+public:
+    SharedPtr<T> Intern(const T& value) {
+        size_t hash = Hash()(value);
+        if (auto found = Find(value, hash)) {
+            return found;
+        }
+        return Insert(MakeShared<T>(value), hash);
+    }
+    SharedPtr<T> Intern(T&& value) {
+        size_t hash = Hash()(value);
+        if (auto found = Find(value, hash)) {
+            return found;
+        }
+        return Insert(MakeShared<T>(std::move(value)), hash);
+    }
+    // Look up by `key`; a `T` is built from it only if there is no equal value yet
+    template <typename Key>
+        requires(InternKey<Key, T, Hash> && !std::is_same_v<Key, T>)
+    SharedPtr<T> Intern(const Key& key) {
+        size_t hash = Hash()(key);
+        if (auto found = Find(key, hash)) {
+            return found;
+        }
+        return Insert(MakeShared<T>(key), hash);
+    }
+
+    // Drop every expired entry
+    void Purge() {
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            it = it->second.Expired() ? entries_.erase(it) : std::next(it);
+        }
+        size_after_purge_ = entries_.size();
+    }
+
+    // Entries, including expired ones not purged yet
+    size_t Size() const {
+        return entries_.size();
+    }
+
+private:
+    template <typename Key>
+    SharedPtr<T> Find(const Key& value, size_t hash) {
+        auto [it, end] = entries_.equal_range(hash);
+        while (it != end) {
+            if (it->second.Expired()) {
+                it = entries_.erase(it);
+            } else if (*it->second.ptr_ == value) {
+                return it->second.Lock();
+            } else {
+                ++it;
+            }
+        }
+        return SharedPtr<T>();
+    }
+
+    SharedPtr<T> Insert(SharedPtr<T> canonical, size_t hash) {
+        entries_.emplace(hash, WeakPtr<T>(canonical));
+        // Sweep whenever the table doubles since the last sweep: O(1) amortized
+        if (entries_.size() >= 2 * std::max<size_t>(size_after_purge_, 8)) {
+            Purge();
+        }
+        return canonical;
+    }
+
+    std::unordered_multimap<size_t, WeakPtr<T>> entries_;
+    size_t size_after_purge_ = 0;
+};
+
+// Table behind `MakeInterned<T>`: one per thread, so canonical objects never cross threads
+template <typename T>
+InternTable<T>& ThreadInternTable() {
+    thread_local InternTable<T> table;
+    return table;
+}
+
+// Canonical `SharedPtr` to `T(args...)`. A single argument that is a `T` or an `InternKey` is
+// looked up as is, so a hit builds nothing; other arguments build a `T` to look it up.
+template <typename T, typename... Args>
+SharedPtr<T> MakeInterned(Args&&... args) {
+    auto& table = ThreadInternTable<T>();
+    if constexpr (sizeof...(Args) == 1 &&
+                  ((std::is_same_v<std::remove_cvref_t<Args>, T> ||
+                    InternKey<std::remove_cvref_t<Args>, T, InternHash<T>>) &&
+                   ...)) {
+        return table.Intern(std::forward<Args>(args)...);
+    } else {
+        return table.Intern(T(std::forward<Args>(args)...));
+    }
+}
@@ -0,0 +1,145 @@
+#include "../shared.h"
+#include "../interned.h"
+#include "../weak.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <malloc.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Symbol {
+    static inline int built = 0;
+
+    explicit Symbol(std::string_view name) : name(name) {
+        ++built;
+    }
+    bool operator==(const Symbol& other) const = default;
+    bool operator==(std::string_view other) const {
+        return name == other;
+    }
+
+    std::string name;
+};
+
+}  // namespace
+
+template <>
+struct InternHash<Symbol> {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view name) const {
+        return std::hash<std::string_view>()(name);
+    }
+    size_t operator()(const Symbol& symbol) const {
+        return (*this)(symbol.name);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("InternTable") {
+    SECTION("Equal values share one object") {
+        InternTable<std::string> table;
+        auto a = table.Intern(std::string("aba"));
+        auto b = table.Intern(std::string("aba"));
+        auto c = table.Intern(std::string("caba"));
+
+        REQUIRE(a.Get() == b.Get());
+        REQUIRE(a.Get() != c.Get());
+        REQUIRE(a.UseCount() == 2);
+        REQUIRE(table.Size() == 2);
+    }
+
+    SECTION("Table does not keep values alive") {
+        InternTable<std::string> table;
+        WeakPtr<std::string> weak;
+        {
+            auto a = table.Intern(std::string("aba"));
+            weak = a;
+        }
+        REQUIRE(weak.Expired());
+
+        auto b = table.Intern(std::string("aba"));
+        REQUIRE(*b == "aba");
+        REQUIRE(table.Size() == 1);
+    }
+
+    SECTION("Expired entries are purged") {
+        InternTable<int> table;
+        for (int i = 0; i < 1000; ++i) {
+            table.Intern(i);
+        }
+        REQUIRE(table.Size() < 1000);
+        table.Purge();
+        REQUIRE(table.Size() == 0);
+
+        auto kept = table.Intern(5);
+        table.Intern(6);
+        table.Purge();
+        REQUIRE(table.Size() == 1);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeInterned") {
+    SECTION("Constructor arguments") {
+        auto a = MakeInterned<std::string>(3, 'x');
+        auto b = MakeInterned<std::string>("xxx");
+        auto c = MakeInterned<std::string>(std::string_view("xxx"));
+        REQUIRE(a.Get() == b.Get());
+        REQUIRE(a.Get() == c.Get());
+    }
+
+    SECTION("Hits by key build nothing") {
+        Symbol::built = 0;
+        auto a = MakeInterned<Symbol>(std::string_view("aba"));
+        REQUIRE(Symbol::built == 1);
+        auto b = MakeInterned<Symbol>(std::string_view("aba"));
+        auto c = MakeInterned<Symbol>("aba");
+        REQUIRE(Symbol::built == 1);
+        REQUIRE(a.Get() == b.Get());
+        REQUIRE(a.Get() == c.Get());
+
+        MakeInterned<Symbol>(Symbol("aba"));
+        REQUIRE(Symbol::built == 2);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Interned memory footprint", "[.bench]") {
+    constexpr int kValues = 1 << 20;
+    constexpr int kDistinct = 1 << 10;
+
+    auto heap_bytes = [] { return mallinfo2().uordblks; };
+    auto tag = [](int i) { return "tag-set-with-a-long-enough-name-" + std::to_string(i % kDistinct); };
+
+    size_t before = heap_bytes();
+    std::vector<SharedPtr<std::string>> separate;
+    separate.reserve(kValues);
+    for (int i = 0; i < kValues; ++i) {
+        separate.push_back(MakeShared<std::string>(tag(i)));
+    }
+    std::cout << "MakeShared:   " << (heap_bytes() - before) / 1024 << " KiB" << std::endl;
+    separate.clear();
+    separate.shrink_to_fit();
+
+    before = heap_bytes();
+    std::vector<SharedPtr<std::string>> interned;
+    interned.reserve(kValues);
+    ReportBench("MakeInterned", MeasureSeconds([&] {
+                    for (int i = 0; i < kValues; ++i) {
+                        interned.push_back(MakeInterned<std::string>(tag(i)));
+                    }
+                }));
+    std::cout << "MakeInterned: " << (heap_bytes() - before) / 1024 << " KiB" << std::endl;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "handles.h"
+#include "shared.h"
+#include "unique.h"
+
+#include <cerrno>
+#include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Address and length of an `mmap`-ed region. The region without an address is the null one.
+struct MappedRegion {
+    MappedRegion() {
+    }
+    MappedRegion(std::nullptr_t) {
+    }
+    MappedRegion(void* addr, size_t length) : addr(addr), length(length) {
+    }
+
+    explicit operator bool() const {
+        return addr != nullptr;
+    }
+    bool operator==(const MappedRegion& other) const = default;
+
+    void* addr = nullptr;
+    size_t length = 0;
+};
+
+struct MmapDeleter {
+    using pointer = MappedRegion;
+
+    void operator()(MappedRegion region) const {
+        munmap(region.addr, region.length);
+    }
+};
+
+// Owning mapping, as big as the region itself
+using UniqueMapping = UniquePtr<void, MmapDeleter>;
+
+struct MapOptions {
+    // Fault the whole file in up front (`MAP_POPULATE`)
+    bool populate = false;
+    // Initial `madvise` hint for the whole mapping
+    int advice = MADV_NORMAL;
+};
+
+// Read-only mapping of a whole file, shared by copies of the `MappedFile` and by every view
+// taken from it: `View<Record>(offset)` is a `SharedPtr<const Record>` aliasing the mapping,
+// which stays mapped until the last of them is gone.
+class MappedFile {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    MappedFile() {
+    }
+    explicit MappedFile(UniqueMapping mapping)
+        : mapping_(MakeShared<UniqueMapping>(std::move(mapping))) {
+    }
+
+    static MappedFile Open(const char* path, MapOptions options = {}) {
+        UniqueFd fd(FdHandle(open(path, O_RDONLY | O_CLOEXEC)));
+        if (!fd) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat info;
+        if (fstat(fd.Get().Get(), &info) != 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        size_t length = static_cast<size_t>(info.st_size);
+        if (length == 0) {
+            return MappedFile(UniqueMapping());
+        }
+
+        int flags = MAP_PRIVATE | (options.populate ? MAP_POPULATE : 0);
+        void* addr = mmap(nullptr, length, PROT_READ, flags, fd.Get().Get(), 0);
+        if (addr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        MappedFile res{UniqueMapping(MappedRegion(addr, length))};
+        if (options.advice != MADV_NORMAL) {
+            res.Advise(options.advice);
+        }
+        return res;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // `madvise` for `[offset, offset + length)`, widened to whole pages
+    void Advise(int advice, size_t offset = 0, size_t length = SIZE_MAX) const {
+        if (Size() == 0) {
+            return;
+        }
+        CheckRange(offset, 0);
+        if (length > Size() - offset) {
+            length = Size() - offset;
+        }
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset / page * page;
+        if (madvise(const_cast<std::byte*>(Data()) + begin, offset + length - begin, advice) !=
+            0) {
+            throw std::system_error(errno, std::generic_category(), "madvise");
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Refcounted typed view into the mapping
+    template <typename T>
+    SharedPtr<const T> View(size_t offset) const {
+        static_assert(std::is_trivially_copyable_v<T>, "Only plain records can live in a file");
+        CheckRange(offset, sizeof(T));
+        if (offset % alignof(T) != 0) {
+            throw std::invalid_argument("MappedFile::View: misaligned offset");
+        }
+        return SharedPtr<const T>(mapping_, reinterpret_cast<const T*>(Data() + offset));
+    }
+    // Borrowed view of `count` records; valid while this `MappedFile` or a view of it is alive
+    template <typename T>
+    std::span<const T> Array(size_t offset, size_t count) const {
+        static_assert(std::is_trivially_copyable_v<T>, "Only plain records can live in a file");
+        if (count > Size() / sizeof(T)) {
+            throw std::out_of_range("MappedFile::Array: past the end");
+        }
+        CheckRange(offset, count * sizeof(T));
+        if (offset % alignof(T) != 0) {
+            throw std::invalid_argument("MappedFile::Array: misaligned offset");
+        }
+        return {reinterpret_cast<const T*>(Data() + offset), count};
+    }
+
+    const std::byte* Data() const {
+        if (!mapping_) {
+            return nullptr;
+        }
+        return static_cast<const std::byte*>(mapping_->Get().addr);
+    }
+    size_t Size() const {
+        if (!mapping_) {
+            return 0;
+        }
+        return mapping_->Get().length;
+    }
+    std::span<const std::byte> Bytes() const {
+        return {Data(), Size()};
+    }
+    // `MappedFile`-s and views alive on this mapping
+    size_t UseCount() const {
+        return mapping_.UseCount();
+    }
+
+private:
+    void CheckRange(size_t offset, size_t length) const {
+        if (offset > Size() || length > Size() - offset) {
+            throw std::out_of_range("MappedFile: range past the end of the file");
+        }
+    }
+
+public:
+    // Fields
+    SharedPtr<UniqueMapping> mapping_;
+};
@@ -0,0 +1,170 @@
+#include "../mapped_file.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Record {
+    uint64_t key;
+    uint64_t value;
+};
+
+// Temporary file removed on destruction
+class TempFile {
+public:
+    explicit TempFile(const void* data, size_t size) {
+        char name[] = "/tmp/mapped_file_XXXXXX";
+        int fd = mkstemp(name);
+        REQUIRE(fd >= 0);
+        path_ = name;
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            auto written = write(fd, bytes, size);
+            REQUIRE(written > 0);
+            bytes += written;
+            size -= written;
+        }
+        close(fd);
+    }
+    ~TempFile() {
+        unlink(path_.c_str());
+    }
+
+    const char* Path() const {
+        return path_.c_str();
+    }
+
+private:
+    std::string path_;
+};
+
+std::vector<Record> MakeRecords(size_t count) {
+    std::vector<Record> records(count);
+    for (size_t i = 0; i < count; ++i) {
+        records[i] = {i, i * i};
+    }
+    return records;
+}
+
+}  // namespace
+
+TEST_CASE("MappedFile") {
+    auto records = MakeRecords(1000);
+    TempFile file(records.data(), records.size() * sizeof(Record));
+
+    SECTION("Bytes and typed views") {
+        auto mapped = MappedFile::Open(file.Path());
+        REQUIRE(mapped.Size() == records.size() * sizeof(Record));
+        auto record = mapped.View<Record>(10 * sizeof(Record));
+        REQUIRE(record->key == 10);
+        REQUIRE(record->value == 100);
+
+        auto all = mapped.Array<Record>(0, 1000);
+        REQUIRE(all[999].value == 999 * 999);
+    }
+
+    SECTION("Views keep the mapping alive") {
+        SharedPtr<const Record> last;
+        {
+            auto mapped = MappedFile::Open(file.Path(), {.populate = true, .advice = MADV_RANDOM});
+            last = mapped.View<Record>(999 * sizeof(Record));
+            REQUIRE(mapped.UseCount() == 2);
+        }
+        REQUIRE(last->key == 999);
+        REQUIRE(last.UseCount() == 1);
+    }
+
+    SECTION("Bad ranges throw") {
+        auto mapped = MappedFile::Open(file.Path());
+        REQUIRE_THROWS_AS(mapped.View<Record>(1000 * sizeof(Record)), std::out_of_range);
+        REQUIRE_THROWS_AS(mapped.View<Record>(3), std::invalid_argument);
+        REQUIRE_THROWS_AS(mapped.Array<Record>(sizeof(Record), 1000), std::out_of_range);
+        REQUIRE_THROWS_AS(MappedFile::Open("/nonexistent/file"), std::system_error);
+    }
+
+    SECTION("Advise") {
+        auto mapped = MappedFile::Open(file.Path());
+        mapped.Advise(MADV_SEQUENTIAL);
+        mapped.Advise(MADV_WILLNEED, 5000, 100);
+    }
+
+    SECTION("Empty file") {
+        TempFile empty(nullptr, 0);
+        auto mapped = MappedFile::Open(empty.Path());
+        REQUIRE(mapped.Size() == 0);
+        REQUIRE(mapped.Bytes().empty());
+    }
+
+    SECTION("UniqueMapping owns the region alone") {
+        REQUIRE(sizeof(UniqueMapping) == sizeof(MappedRegion));
+        void* addr = mmap(nullptr, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                          0);
+        REQUIRE(addr != MAP_FAILED);
+        UniqueMapping mapping(MappedRegion(addr, 4096));
+        static_cast<char*>(mapping.Get().addr)[0] = 'a';
+        MappedFile shared(std::move(mapping));
+        REQUIRE(!mapping);
+        REQUIRE(static_cast<char>(shared.Data()[0]) == 'a');
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MappedFile bench", "[.bench]") {
+    constexpr size_t kSize = size_t{256} << 20;
+    constexpr size_t kChunk = size_t{1} << 20;
+
+    std::vector<uint64_t> data(kSize / sizeof(uint64_t));
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = i;
+    }
+    TempFile file(data.data(), kSize);
+    data = {};
+
+    auto sum_words = [](const uint64_t* words, size_t count) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += words[i];
+        }
+        return sum;
+    };
+
+    uint64_t expected = 0;
+    ReportBench("read into a heap buffer", MeasureSeconds([&] {
+        std::vector<uint64_t> buffer(kChunk / sizeof(uint64_t));
+        int fd = open(file.Path(), O_RDONLY);
+        ssize_t got;
+        while ((got = read(fd, buffer.data(), kChunk)) > 0) {
+            expected += sum_words(buffer.data(), got / sizeof(uint64_t));
+        }
+        close(fd);
+    }));
+
+    for (auto [name, options] : {std::pair{"mmap", MapOptions{}},
+                                 std::pair{"mmap + MADV_SEQUENTIAL",
+                                           MapOptions{.advice = MADV_SEQUENTIAL}},
+                                 std::pair{"mmap + MAP_POPULATE", MapOptions{.populate = true}}}) {
+        uint64_t sum = 0;
+        ReportBench(name, MeasureSeconds([&] {
+            auto mapped = MappedFile::Open(file.Path(), options);
+            auto words = mapped.Array<uint64_t>(0, kSize / sizeof(uint64_t));
+            sum = sum_words(words.data(), words.size());
+        }));
+        REQUIRE(sum == expected);
+    }
+}
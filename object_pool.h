@@ -0,0 +1,123 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+template <typename T>
+class BlockPooled;
+
+// State shared between an `ObjectPool` and the blocks it handed out. It outlives the pool
+// until every outstanding block has come back.
+template <typename T>
+struct PoolState {
+    std::vector<BlockPooled<T>*> free_;
+    size_t capacity_;
+    void (*reset_)(T&);
+    size_t outstanding_ = 0;
+    bool closed_ = false;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+
+    void Return(BlockPooled<T>* block) {
+        outstanding_--;
+        if (!closed_ && free_.size() < capacity_) {
+            free_.push_back(block);
+            return;
+        }
+        block->Drop();
+        if (closed_ && outstanding_ == 0) {
+            delete this;
+        }
+    }
+};
+
+// Control block whose object survives the last strong reference: instead of being destroyed
+// and deleted, the pair goes back to the pool it came from
+template <typename T>
+class BlockPooled : public BlockObject<T> {
+public:
+    explicit BlockPooled(PoolState<T>* pool) : BlockObject<T>(), pool_(pool) {
+    }
+
+    void Destruct() override {
+        if (pool_->reset_) {
+            pool_->reset_(*this->GetPtr());
+        }
+    }
+    void Deallocate() override {
+        pool_->Return(this);
+    }
+
+    // Really destroy the object and free the block
+    void Drop() {
+        BlockObject<T>::Destruct();
+        delete this;
+    }
+
+    PoolState<T>* pool_;
+};
+
+// Recycles objects handed out as `SharedPtr<T>`. A recycled object is passed through `reset`
+// (if any) when its last strong reference dies and is reused as is by the next `Acquire()`.
+//
+// Like the counters in `BlockBase`, a pool is not synchronized: give each thread its own free
+// list by declaring the pool `thread_local`.
+template <typename T>
+class ObjectPool {
+    // A recycled object would keep a weak reference to itself and never come back
+    static_assert(!std::is_base_of_v<WhoAmI, T>, "EnableSharedFromThis types can't be pooled");
+
+public:
+    explicit ObjectPool(size_t capacity = 1024, void (*reset)(T&) = nullptr)
+        : state_(new PoolState<T>{{}, capacity, reset}) {
+    }
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        for (auto block : state_->free_) {
+            block->Drop();
+        }
+        state_->free_.clear();
+        state_->closed_ = true;
+        if (state_->outstanding_ == 0) {
+            delete state_;
+        }
+    }
+
+    SharedPtr<T> Acquire() {
+        BlockPooled<T>* block;
+        if (!state_->free_.empty()) {
+            block = state_->free_.back();
+            state_->free_.pop_back();
+            block->strong_ = 1;
+            state_->hits_++;
+        } else {
+            block = new BlockPooled<T>(state_);
+            state_->misses_++;
+        }
+        state_->outstanding_++;
+
+        SharedPtr<T> res;
+        res.block_ = block;
+        res.ptr_ = block->GetPtr();
+        return res;
+    }
+
+    // Objects waiting in the free list
+    size_t Size() const {
+        return state_->free_.size();
+    }
+    size_t Hits() const {
+        return state_->hits_;
+    }
+    size_t Misses() const {
+        return state_->misses_;
+    }
+
+private:
+    PoolState<T>* state_;
+};
@@ -0,0 +1,105 @@
+#include "../shared.h"
+#include "../object_pool.h"
+#include "../weak.h"
+#include "../my_int.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ObjectPool") {
+    SECTION("Recycles objects") {
+        ObjectPool<MyInt> pool;
+        MyInt* first;
+        {
+            auto a = pool.Acquire();
+            first = a.Get();
+            REQUIRE(a.UseCount() == 1);
+            REQUIRE(pool.Misses() == 1);
+        }
+        REQUIRE(pool.Size() == 1);
+        REQUIRE(MyInt::AliveCount() == 1);
+
+        auto b = pool.Acquire();
+        REQUIRE(b.Get() == first);
+        REQUIRE(b.UseCount() == 1);
+        REQUIRE(pool.Hits() == 1);
+        REQUIRE(pool.Size() == 0);
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+
+    SECTION("Reset on return") {
+        ObjectPool<std::string> pool(4, [](std::string& str) { str.clear(); });
+        {
+            auto str = pool.Acquire();
+            *str = "aba";
+        }
+        REQUIRE(pool.Acquire()->empty());
+    }
+
+    SECTION("Capacity") {
+        ObjectPool<MyInt> pool(2);
+        {
+            std::vector<SharedPtr<MyInt>> ptrs;
+            for (int i = 0; i < 5; ++i) {
+                ptrs.push_back(pool.Acquire());
+            }
+            REQUIRE(MyInt::AliveCount() == 5);
+        }
+        REQUIRE(pool.Size() == 2);
+        REQUIRE(MyInt::AliveCount() == 2);
+        REQUIRE(pool.Misses() == 5);
+    }
+
+    SECTION("Weak references delay recycling") {
+        ObjectPool<MyInt> pool;
+        WeakPtr<MyInt> weak;
+        {
+            auto ptr = pool.Acquire();
+            weak = ptr;
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(pool.Size() == 0);
+        weak.Reset();
+        REQUIRE(pool.Size() == 1);
+    }
+
+    SECTION("Objects outlive the pool") {
+        SharedPtr<MyInt> survivor;
+        {
+            ObjectPool<MyInt> pool;
+            survivor = pool.Acquire();
+            pool.Acquire();
+        }
+        REQUIRE(MyInt::AliveCount() == 1);
+        survivor.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ObjectPool vs MakeShared", "[.bench]") {
+    constexpr int kRounds = 1 << 20;
+    struct Message {
+        char payload[256];
+    };
+
+    ReportBench("MakeShared", MeasureSeconds([] {
+                    for (int i = 0; i < kRounds; ++i) {
+                        auto message = MakeShared<Message>();
+                        DoNotOptimize(message.Get());
+                    }
+                }));
+    ObjectPool<Message> pool;
+    ReportBench("ObjectPool::Acquire", MeasureSeconds([&] {
+                    for (int i = 0; i < kRounds; ++i) {
+                        auto message = pool.Acquire();
+                        DoNotOptimize(message.Get());
+                    }
+                }));
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "shared.h"
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <memory>
+#include <utility>
+
+// Non-owning reference to an object owned by an `ObservedPtr`: `Get()` returns `nullptr` once
+// the owner has let the object go. Counts itself in `weak_` of the owner's side block.
+template <typename T>
+class ObserverPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ObserverPtr() {
+    }
+    ObserverPtr(BlockBase* block, T* ptr) : block_(block), ptr_(ptr) {
+        block_->AddWeak();
+    }
+
+    ObserverPtr(const ObserverPtr& other) : block_(other.block_), ptr_(other.ptr_) {
+        if (block_) {
+            block_->AddWeak();
+        }
+    }
+    ObserverPtr(ObserverPtr&& other) : block_(other.block_), ptr_(other.ptr_) {
+        other.block_ = nullptr;
+        other.ptr_ = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ObserverPtr& operator=(const ObserverPtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        ptr_ = other.ptr_;
+        if (block_) {
+            block_->AddWeak();
+        }
+        return *this;
+    }
+    ObserverPtr& operator=(ObserverPtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        std::swap(block_, other.block_);
+        std::swap(ptr_, other.ptr_);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~ObserverPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        if (block_) {
+            block_->weak_--;
+            if (block_->weak_ + block_->strong_ == 0) {
+                block_->Deallocate();
+            }
+        }
+        block_ = nullptr;
+        ptr_ = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // The observed object, or `nullptr` if its owner is gone
+    T* Get() const {
+        return Expired() ? nullptr : ptr_;
+    }
+    bool Expired() const {
+        return !(block_ && block_->strong_ > 0);
+    }
+    explicit operator bool() const {
+        return !Expired();
+    }
+
+    // Fields
+    BlockBase* block_ = nullptr;
+    T* ptr_ = nullptr;
+};
+
+// `UniquePtr` that can hand out `ObserverPtr`-s. The side block with the counters is created by
+// the first `Observe()`, so an owner that is never observed costs one null pointer, and moving
+// an owner never touches a counter. The block is marked dead (its `strong_` drops to zero)
+// before the object is destroyed, so observers see it gone from within `~T`, and expiration
+// callbacks run once the destructor has finished.
+template <typename T, typename Deleter = std::default_delete<T>>
+class ObservedPtr {
+    // Side block whose `Destruct()` moves the owner on to its next object
+    struct SideBlock : BlockBase {
+        void Destruct() override {
+            if (owner) {
+                owner->Reset(next);
+            }
+        }
+
+        UniquePtr<T, Deleter>* owner = nullptr;
+        T* next = nullptr;
+    };
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ObservedPtr() {
+    }
+    ObservedPtr(std::nullptr_t) {
+    }
+    explicit ObservedPtr(T* ptr) : owner_(ptr) {
+    }
+    template <typename Del2>
+    ObservedPtr(T* ptr, Del2&& deleter) : owner_(ptr, std::forward<Del2>(deleter)) {
+    }
+
+    ObservedPtr(ObservedPtr&& other) noexcept
+        : owner_(std::move(other.owner_)), block_(other.block_) {
+        other.block_ = nullptr;
+    }
+    ObservedPtr(const ObservedPtr&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ObservedPtr& operator=(ObservedPtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        owner_ = std::move(other.owner_);
+        block_ = other.block_;
+        other.block_ = nullptr;
+        return *this;
+    }
+    ObservedPtr& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+    ObservedPtr& operator=(const ObservedPtr&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~ObservedPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Give up ownership; observers can no longer tell whether the object is alive, so they expire
+    T* Release() {
+        SideBlock* block = std::exchange(block_, nullptr);
+        T* res = owner_.Release();
+        if (block) {
+            block->ReleaseStrong();
+        }
+        return res;
+    }
+    void Reset(T* ptr = nullptr) {
+        if (owner_.Get() == ptr) {
+            return;
+        }
+        SideBlock* block = std::exchange(block_, nullptr);
+        if (!block) {
+            owner_.Reset(ptr);
+            return;
+        }
+        // Dropping the last strong count marks the block dead, then destroys the old object
+        // through `Destruct()`, then fires the expiration callbacks
+        block->owner = &owner_;
+        block->next = ptr;
+        block->ReleaseStrong();
+    }
+    void Swap(ObservedPtr& other) {
+        owner_.Swap(other.owner_);
+        std::swap(block_, other.block_);
+    }
+
+    // New observer of the current object
+    ObserverPtr<T> Observe() const {
+        if (!owner_) {
+            return ObserverPtr<T>();
+        }
+        if (!block_) {
+            block_ = new SideBlock();
+        }
+        return ObserverPtr<T>(block_, owner_.Get());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return owner_.Get();
+    }
+    T& operator*() const {
+        return *owner_;
+    }
+    T* operator->() const {
+        return owner_.Get();
+    }
+    Deleter& GetDeleter() {
+        return owner_.GetDeleter();
+    }
+    const Deleter& GetDeleter() const {
+        return owner_.GetDeleter();
+    }
+    explicit operator bool() const {
+        return static_cast<bool>(owner_);
+    }
+
+    // Fields
+    UniquePtr<T, Deleter> owner_;
+    mutable SideBlock* block_ = nullptr;
+};
+
+template <typename T, typename... Args>
+ObservedPtr<T> MakeObserved(Args&&... args) {
+    return ObservedPtr<T>(new T(std::forward<Args>(args)...));
+}
@@ -0,0 +1,185 @@
+#include "../observed.h"
+#include "../expire.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ObservedPtr") {
+    SECTION("Unobserved owner has no side block") {
+        auto owner = MakeObserved<std::string>("aba");
+        REQUIRE(*owner == "aba");
+        REQUIRE(owner.block_ == nullptr);
+        REQUIRE(sizeof(owner) == sizeof(UniquePtr<std::string>) + sizeof(void*));
+
+        auto moved = std::move(owner);
+        REQUIRE(!owner);
+        REQUIRE(*moved == "aba");
+    }
+
+    SECTION("Observers see the object until the owner dies") {
+        ObserverPtr<std::string> observer;
+        {
+            auto owner = MakeObserved<std::string>("aba");
+            observer = owner.Observe();
+            REQUIRE(observer.Get() == owner.Get());
+            REQUIRE(owner.block_->strong_ == 1);
+            REQUIRE(owner.block_->weak_ == 1);
+        }
+        REQUIRE(observer.Expired());
+        REQUIRE(observer.Get() == nullptr);
+    }
+
+    SECTION("Moving the owner keeps observers valid") {
+        auto owner = MakeObserved<int>(5);
+        auto observer = owner.Observe();
+        BlockBase* block = owner.block_;
+
+        std::vector<ObservedPtr<int>> owners;
+        owners.push_back(std::move(owner));
+        REQUIRE(owners[0].block_ == block);
+        REQUIRE(block->weak_ == 1);
+        REQUIRE(*observer.Get() == 5);
+
+        owners.clear();
+        REQUIRE(!observer);
+    }
+
+    SECTION("Reset expires observers of the old object only") {
+        auto owner = MakeObserved<int>(1);
+        auto first = owner.Observe();
+        owner.Reset(new int(2));
+        REQUIRE(first.Expired());
+
+        auto second = owner.Observe();
+        REQUIRE(*second.Get() == 2);
+        REQUIRE(first.block_ != second.block_);
+    }
+
+    SECTION("Release expires observers") {
+        auto owner = MakeObserved<int>(1);
+        auto observer = owner.Observe();
+        std::unique_ptr<int> raw(owner.Release());
+        REQUIRE(observer.Expired());
+        REQUIRE(*raw == 1);
+    }
+
+    SECTION("Observers copy and outlive each other") {
+        auto owner = MakeObserved<int>(1);
+        auto a = owner.Observe();
+        auto b = a;
+        auto c = owner.Observe();
+        REQUIRE(owner.block_->weak_ == 3);
+        a.Reset();
+        owner.Reset();
+        REQUIRE(b.Expired());
+        REQUIRE(c.Expired());
+    }
+
+    SECTION("Observing an empty owner") {
+        ObservedPtr<int> owner;
+        REQUIRE(owner.Observe().Expired());
+        REQUIRE(owner.block_ == nullptr);
+    }
+
+    SECTION("Expiration callbacks fire on owner death") {
+        int fired = 0;
+        auto owner = MakeObserved<int>(1);
+        auto observer = owner.Observe();
+        OnExpire(
+            observer.block_, [](void* ctx, BlockBase*) { ++*static_cast<int*>(ctx); }, &fired);
+        owner = nullptr;
+        REQUIRE(fired == 1);
+    }
+
+    SECTION("Expiration callbacks run after the object is destroyed") {
+        struct Tracked {
+            ~Tracked() {
+                *alive = false;
+            }
+            bool* alive;
+        };
+        struct Seen {
+            bool alive = true;
+            bool alive_at_expire = true;
+        } seen;
+
+        auto owner = MakeObserved<Tracked>(&seen.alive);
+        auto observer = owner.Observe();
+        OnExpire(
+            observer.block_,
+            [](void* ctx, BlockBase*) {
+                auto seen = static_cast<Seen*>(ctx);
+                seen->alive_at_expire = seen->alive;
+            },
+            &seen);
+        owner.Reset();
+        REQUIRE(!seen.alive);
+        REQUIRE(!seen.alive_at_expire);
+        REQUIRE(observer.Expired());
+    }
+
+    SECTION("Observers see the object gone from its own destructor") {
+        struct Watched {
+            ~Watched() {
+                *observed_alive = self.Get() != nullptr;
+            }
+            bool* observed_alive;
+            ObserverPtr<Watched> self = {};
+        };
+
+        bool observed_alive = true;
+        auto owner = MakeObserved<Watched>(&observed_alive);
+        owner->self = owner.Observe();
+        owner.Reset(new Watched{&observed_alive});
+        REQUIRE(!observed_alive);
+
+        observed_alive = true;
+        owner->self = owner.Observe();
+        owner = nullptr;
+        REQUIRE(!observed_alive);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ObservedPtr bench", "[.bench]") {
+    constexpr int kCount = 1 << 16;
+    constexpr int kRounds = 64;
+
+    std::vector<ObservedPtr<int>> observed(kCount);
+    std::vector<SharedPtr<int>> shared(kCount);
+    for (int i = 0; i < kCount; ++i) {
+        observed[i] = MakeObserved<int>(i);
+        shared[i] = MakeShared<int>(i);
+    }
+
+    // Owners shuffled between containers, the case that made people reach for SharedPtr
+    ReportBench("move ObservedPtr owners", MeasureSeconds([&] {
+        for (int round = 0; round < kRounds; ++round) {
+            std::vector<ObservedPtr<int>> next;
+            next.reserve(kCount);
+            for (auto& owner : observed) {
+                next.push_back(std::move(owner));
+            }
+            observed.swap(next);
+        }
+    }));
+    ReportBench("copy SharedPtr owners", MeasureSeconds([&] {
+        for (int round = 0; round < kRounds; ++round) {
+            std::vector<SharedPtr<int>> next;
+            next.reserve(kCount);
+            for (auto& owner : shared) {
+                next.push_back(owner);
+            }
+            shared.swap(next);
+        }
+    }));
+    DoNotOptimize(observed.data());
+    DoNotOptimize(shared.data());
+}
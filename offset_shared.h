@@ -0,0 +1,471 @@
+#pragma once
+
+#include "handles.h"
+#include "mapped_file.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Ownership of objects inside a shared-memory segment, usable from every process that maps it,
+// at whatever address. Nothing stored in the segment is an absolute address:
+// - the allocator works with offsets from the start of the segment;
+// - `OffsetSharedPtr`/`OffsetWeakPtr` store the distance from themselves to the control block,
+//   which is the same in every mapping when both live in the segment, and still right for a
+//   process-local copy on the stack;
+// - counters are lock-free `std::atomic`-s, which are address-free and thus process-shared.
+//
+// The counters are the only atomics: an `OffsetSharedPtr` itself, including a root slot of the
+// segment, is a plain self-relative field. Processes (or threads) that update the same pointer
+// concurrently, e.g. publish into `Segment::Root`, need their own synchronization.
+//
+// Objects must not be polymorphic or hold process-local pointers. Their destructors run in
+// whichever process drops the last strong reference, so every process has to run the same
+// binary (or at least agree on the types).
+
+static_assert(std::atomic<int32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Start of every segment: allocator state and a few root slots to find shared objects by
+struct SegmentHeader {
+    static constexpr uint64_t kMagic = 0x544e454d47455301;  // "\1SEGMENT"
+    static constexpr size_t kMinClass = 5;                  // 32 bytes
+    static constexpr size_t kClasses = 48;
+    static constexpr size_t kRoots = 16;
+    static constexpr size_t kAlignment = 16;
+
+    explicit SegmentHeader(uint64_t size) : size_(size) {
+    }
+
+    // Offset of at least `size` free bytes, aligned to `kAlignment`. Sizes are rounded up to a
+    // power of two; freed chunks go to the free list of their class and are reused as is.
+    uint64_t Allocate(size_t size, uint32_t& size_class) {
+        size_class = kMinClass;
+        while ((uint64_t{1} << size_class) < size) {
+            ++size_class;
+        }
+        if (size_class >= kClasses) {
+            throw std::bad_alloc();
+        }
+
+        Lock();
+        uint64_t offset = free_[size_class];
+        if (offset != 0) {
+            free_[size_class] = *reinterpret_cast<uint64_t*>(Base() + offset);
+        } else if (top_ + (uint64_t{1} << size_class) <= size_) {
+            offset = top_;
+            top_ += uint64_t{1} << size_class;
+        }
+        Unlock();
+
+        if (offset == 0) {
+            throw std::bad_alloc();
+        }
+        return offset;
+    }
+    void Free(uint64_t offset, uint32_t size_class) {
+        Lock();
+        *reinterpret_cast<uint64_t*>(Base() + offset) = free_[size_class];
+        free_[size_class] = offset;
+        Unlock();
+    }
+
+    char* Base() {
+        return reinterpret_cast<char*>(this);
+    }
+
+    uint64_t magic_ = kMagic;
+    uint64_t size_;
+    // Bump pointer; everything below it was handed out at some point
+    uint64_t top_ = (sizeof(SegmentHeader) + kAlignment - 1) / kAlignment * kAlignment;
+    uint64_t free_[kClasses] = {};
+    // Zero-filled storage for `Segment::Root<T>()`: a zero relative pointer is a null one
+    alignas(8) char roots_[kRoots][8] = {};
+
+private:
+    // Cross-process spinlock around the free lists. A process dying inside it wedges the
+    // segment, which is why it only ever guards a handful of loads and stores.
+    void Lock() {
+        while (lock_.exchange(1, std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+    void Unlock() {
+        lock_.store(0, std::memory_order_release);
+    }
+
+    std::atomic<uint32_t> lock_ = 0;
+};
+
+// Control block in front of its object. `weak_` counts the weak references plus one for all the
+// strong ones together, so only one process ever sees it drop to zero.
+struct OffsetBlock {
+    OffsetBlock(uint64_t offset, uint32_t size_class) : offset_(offset), size_class_(size_class) {
+    }
+
+    template <typename T>
+    static constexpr size_t ObjectOffset() {
+        return (sizeof(OffsetBlock) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    template <typename T>
+    T* Object() {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + ObjectOffset<T>());
+    }
+    SegmentHeader* Header() {
+        return reinterpret_cast<SegmentHeader*>(reinterpret_cast<char*>(this) - offset_);
+    }
+
+    void ReleaseWeak() {
+        if (weak_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            auto header = Header();
+            uint64_t offset = offset_;
+            uint32_t size_class = size_class_;
+            this->~OffsetBlock();
+            header->Free(offset, size_class);
+        }
+    }
+
+    std::atomic<int32_t> strong_ = 1;
+    std::atomic<int32_t> weak_ = 1;
+    // Own offset from the segment start, to find the allocator from any mapping
+    uint64_t offset_;
+    uint32_t size_class_;
+};
+
+// Self-relative pointer to an `OffsetBlock`: 0 is null, anything else is the distance from the
+// field itself. Copying one always goes through the absolute address.
+class RelativeBlock {
+public:
+    RelativeBlock() {
+    }
+    RelativeBlock(const RelativeBlock& other) {
+        Set(other.Get());
+    }
+    RelativeBlock& operator=(const RelativeBlock& other) {
+        Set(other.Get());
+        return *this;
+    }
+
+    OffsetBlock* Get() const {
+        if (diff_ == 0) {
+            return nullptr;
+        }
+        return reinterpret_cast<OffsetBlock*>(Address() + diff_);
+    }
+    void Set(OffsetBlock* block) {
+        diff_ = block ? reinterpret_cast<uintptr_t>(block) - Address() : 0;
+    }
+
+private:
+    // Integer address: the block and this field are usually separate objects (one in the
+    // segment, one on the stack), so pointer arithmetic between them would be undefined
+    uintptr_t Address() const {
+        return reinterpret_cast<uintptr_t>(this);
+    }
+
+    // Wraps modulo 2^64 like the `uintptr_t` arithmetic above; 0 is null
+    uint64_t diff_ = 0;
+};
+
+template <typename T>
+class OffsetWeakPtr;
+
+// `SharedPtr` whose control block and object live in a segment. Works the same from inside the
+// segment (e.g. as a member of another shared object) and from process-local memory.
+template <typename T>
+class OffsetSharedPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    OffsetSharedPtr() {
+    }
+    OffsetSharedPtr(std::nullptr_t) {
+    }
+    // Adopt a reference that was already counted
+    explicit OffsetSharedPtr(OffsetBlock* block) {
+        block_.Set(block);
+    }
+
+    OffsetSharedPtr(const OffsetSharedPtr& other) : block_(other.block_) {
+        if (auto block = block_.Get()) {
+            block->strong_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    OffsetSharedPtr(OffsetSharedPtr&& other) : block_(other.block_) {
+        other.block_.Set(nullptr);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    OffsetSharedPtr& operator=(const OffsetSharedPtr& other) {
+        if (block_.Get() == other.block_.Get()) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        if (auto block = block_.Get()) {
+            block->strong_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return *this;
+    }
+    OffsetSharedPtr& operator=(OffsetSharedPtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        other.block_.Set(nullptr);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~OffsetSharedPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        auto block = block_.Get();
+        block_.Set(nullptr);
+        if (block && block->strong_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            block->Object<T>()->~T();
+            block->ReleaseWeak();
+        }
+    }
+    void Swap(OffsetSharedPtr& other) {
+        auto block = block_.Get();
+        block_ = other.block_;
+        other.block_.Set(block);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        auto block = block_.Get();
+        return block ? block->Object<T>() : nullptr;
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    size_t UseCount() const {
+        auto block = block_.Get();
+        return block ? block->strong_.load(std::memory_order_relaxed) : 0;
+    }
+    explicit operator bool() const {
+        return block_.Get() != nullptr;
+    }
+
+    // Fields
+    RelativeBlock block_;
+};
+
+template <typename T>
+class OffsetWeakPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    OffsetWeakPtr() {
+    }
+    OffsetWeakPtr(const OffsetSharedPtr<T>& other) : block_(other.block_) {
+        Retain();
+    }
+    OffsetWeakPtr(const OffsetWeakPtr& other) : block_(other.block_) {
+        Retain();
+    }
+    OffsetWeakPtr(OffsetWeakPtr&& other) : block_(other.block_) {
+        other.block_.Set(nullptr);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    OffsetWeakPtr& operator=(const OffsetWeakPtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        Retain();
+        return *this;
+    }
+    OffsetWeakPtr& operator=(OffsetWeakPtr&& other) {
+        if (this == &other) {
+            return *this;
+        }
+        Reset();
+        block_ = other.block_;
+        other.block_.Set(nullptr);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~OffsetWeakPtr() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        auto block = block_.Get();
+        block_.Set(nullptr);
+        if (block) {
+            block->ReleaseWeak();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    bool Expired() const {
+        auto block = block_.Get();
+        return !block || block->strong_.load(std::memory_order_acquire) == 0;
+    }
+    // Another process may drop the last reference at any moment, so promotion is a CAS loop
+    OffsetSharedPtr<T> Lock() const {
+        auto block = block_.Get();
+        if (!block) {
+            return OffsetSharedPtr<T>();
+        }
+        int32_t count = block->strong_.load(std::memory_order_relaxed);
+        while (count > 0) {
+            if (block->strong_.compare_exchange_weak(count, count + 1,
+                                                     std::memory_order_acq_rel)) {
+                return OffsetSharedPtr<T>(block);
+            }
+        }
+        return OffsetSharedPtr<T>();
+    }
+
+    // Fields
+    RelativeBlock block_;
+
+private:
+    void Retain() {
+        if (auto block = block_.Get()) {
+            block->weak_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+// A `memfd_create` segment mapped into this process. Other processes (or this one, again) map
+// the same memory through `Attach(fd)`, typically after inheriting or receiving the descriptor.
+// Pointers held in process-local memory must not outlive the `Segment` they point into.
+class Segment {
+public:
+    static Segment Create(size_t size, const char* name = "segment") {
+        if (size < sizeof(SegmentHeader)) {
+            throw std::invalid_argument("Segment::Create: too small for the header");
+        }
+        UniqueFd fd(FdHandle(memfd_create(name, MFD_CLOEXEC)));
+        if (!fd) {
+            throw std::system_error(errno, std::generic_category(), "memfd_create");
+        }
+        if (ftruncate(fd.Get().Get(), static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        Segment res(std::move(fd), size);
+        new (res.Base()) SegmentHeader(size);
+        return res;
+    }
+    static Segment Attach(int fd) {
+        UniqueFd own(FdHandle(dup(fd)));
+        struct stat info;
+        if (!own || fstat(own.Get().Get(), &info) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Segment::Attach");
+        }
+        if (static_cast<size_t>(info.st_size) < sizeof(SegmentHeader)) {
+            throw std::invalid_argument("Segment::Attach: not a segment");
+        }
+        Segment res(std::move(own), static_cast<size_t>(info.st_size));
+        if (res.Header()->magic_ != SegmentHeader::kMagic) {
+            throw std::invalid_argument("Segment::Attach: not a segment");
+        }
+        return res;
+    }
+
+    // Root slot `i`, shared by all mappings; the caller picks `T` consistently. The slot is not
+    // atomic: concurrent updates of it from other processes need outside synchronization.
+    template <typename T>
+    OffsetSharedPtr<T>& Root(size_t i) {
+        static_assert(sizeof(OffsetSharedPtr<T>) == sizeof(Header()->roots_[0]));
+        if (i >= SegmentHeader::kRoots) {
+            throw std::out_of_range("Segment::Root: no such slot");
+        }
+        return *reinterpret_cast<OffsetSharedPtr<T>*>(Header()->roots_[i]);
+    }
+
+    SegmentHeader* Header() const {
+        return reinterpret_cast<SegmentHeader*>(mapping_.Get().addr);
+    }
+    char* Base() const {
+        return static_cast<char*>(mapping_.Get().addr);
+    }
+    size_t Size() const {
+        return mapping_.Get().length;
+    }
+    int Fd() const {
+        return fd_.Get().Get();
+    }
+    // Bytes handed out by the bump allocator so far, free lists included
+    size_t BytesUsed() const {
+        return Header()->top_;
+    }
+
+private:
+    Segment(UniqueFd fd, size_t size) : fd_(std::move(fd)) {
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_.Get().Get(), 0);
+        if (addr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        mapping_.Reset(MappedRegion(addr, size));
+    }
+
+    UniqueFd fd_;
+    UniqueMapping mapping_;
+};
+
+// `MakeShared` into a segment: control block and object in one allocation
+template <typename T, typename... Args>
+OffsetSharedPtr<T> MakeOffsetShared(Segment& segment, Args&&... args) {
+    static_assert(!std::is_polymorphic_v<T>, "Vtable pointers differ between processes");
+    static_assert(alignof(T) <= SegmentHeader::kAlignment);
+
+    auto header = segment.Header();
+    uint32_t size_class;
+    uint64_t offset = header->Allocate(OffsetBlock::ObjectOffset<T>() + sizeof(T), size_class);
+    auto block = new (header->Base() + offset) OffsetBlock(offset, size_class);
+    try {
+        new (block->Object<T>()) T(std::forward<Args>(args)...);
+    } catch (...) {
+        block->~OffsetBlock();
+        header->Free(offset, size_class);
+        throw;
+    }
+    return OffsetSharedPtr<T>(block);
+}
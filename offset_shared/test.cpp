@@ -0,0 +1,150 @@
+#include "../offset_shared.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Node {
+    static inline int destroyed = 0;
+
+    explicit Node(int value) : value(value) {
+    }
+    ~Node() {
+        ++destroyed;
+    }
+
+    int value;
+    OffsetSharedPtr<Node> next;
+};
+
+}  // namespace
+
+TEST_CASE("OffsetSharedPtr") {
+    auto first = Segment::Create(1 << 20);
+    auto second = Segment::Attach(first.Fd());
+    REQUIRE(first.Base() != second.Base());
+    Node::destroyed = 0;
+
+    SECTION("Two mappings see the same objects") {
+        auto head = MakeOffsetShared<Node>(first, 1);
+        head->next = MakeOffsetShared<Node>(first, 2);
+        first.Root<Node>(0) = head;
+        REQUIRE(head.UseCount() == 2);
+
+        // Reached through the other mapping: a different address, the same counters
+        auto other = second.Root<Node>(0);
+        REQUIRE(other.Get() != head.Get());
+        REQUIRE(reinterpret_cast<char*>(other.Get()) - second.Base() ==
+                reinterpret_cast<char*>(head.Get()) - first.Base());
+        REQUIRE(head.UseCount() == 3);
+        REQUIRE(other->next->value == 2);
+
+        other->next->value = 20;
+        REQUIRE(head->next->value == 20);
+    }
+
+    SECTION("Last owner in any mapping frees the object") {
+        first.Root<Node>(0) = MakeOffsetShared<Node>(first, 1);
+        auto other = second.Root<Node>(0);
+        auto offset = reinterpret_cast<char*>(other.Get()) - second.Base();
+
+        first.Root<Node>(0).Reset();
+        REQUIRE(Node::destroyed == 0);
+        REQUIRE(other.UseCount() == 1);
+        other.Reset();
+        REQUIRE(Node::destroyed == 1);
+
+        // The chunk is back on its free list
+        auto again = MakeOffsetShared<Node>(second, 3);
+        REQUIRE(reinterpret_cast<char*>(again.Get()) - second.Base() == offset);
+    }
+
+    SECTION("Weak references") {
+        OffsetWeakPtr<Node> weak;
+        {
+            auto node = MakeOffsetShared<Node>(first, 1);
+            second.Root<Node>(1) = node;
+            weak = node;
+            REQUIRE(weak.Lock()->value == 1);
+        }
+        REQUIRE(!weak.Expired());
+        second.Root<Node>(1).Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(!weak.Lock());
+    }
+
+    SECTION("Segment exhaustion") {
+        std::vector<OffsetSharedPtr<Node>> nodes;
+        REQUIRE_THROWS_AS(
+            [&] {
+                for (;;) {
+                    nodes.push_back(MakeOffsetShared<Node>(first, 0));
+                }
+            }(),
+            std::bad_alloc);
+        REQUIRE(first.BytesUsed() <= first.Size());
+    }
+
+    SECTION("Bad sizes and slots") {
+        REQUIRE_THROWS_AS(Segment::Create(sizeof(SegmentHeader) - 1), std::invalid_argument);
+
+        int fd = memfd_create("small", MFD_CLOEXEC);
+        REQUIRE(fd >= 0);
+        REQUIRE(ftruncate(fd, 8) == 0);
+        REQUIRE_THROWS_AS(Segment::Attach(fd), std::invalid_argument);
+        close(fd);
+
+        REQUIRE_THROWS_AS(first.Root<Node>(SegmentHeader::kRoots), std::out_of_range);
+    }
+
+    SECTION("Processes share counters") {
+        constexpr int kChildren = 4;
+        constexpr int kRounds = 10000;
+
+        first.Root<Node>(0) = MakeOffsetShared<Node>(first, 42);
+        std::vector<pid_t> children;
+        for (int child = 0; child < kChildren; ++child) {
+            pid_t pid = fork();
+            REQUIRE(pid >= 0);
+            if (pid == 0) {
+                // A fresh mapping in the child, at yet another address
+                auto mapping = Segment::Attach(first.Fd());
+                auto& root = mapping.Root<Node>(0);
+                bool ok = true;
+                for (int i = 0; i < kRounds; ++i) {
+                    auto copy = root;
+                    ok = ok && copy->value == 42;
+                }
+                mapping.Root<Node>(1 + child) = root;
+                _exit(ok ? 0 : 1);
+            }
+            children.push_back(pid);
+        }
+        for (pid_t pid : children) {
+            int status = 0;
+            REQUIRE(waitpid(pid, &status, 0) == pid);
+            REQUIRE(WIFEXITED(status));
+            REQUIRE(WEXITSTATUS(status) == 0);
+        }
+        REQUIRE(first.Root<Node>(0).UseCount() == 1 + kChildren);
+        for (int child = 0; child < kChildren; ++child) {
+            first.Root<Node>(1 + child).Reset();
+        }
+        REQUIRE(first.Root<Node>(0).UseCount() == 1);
+    }
+
+    for (size_t i = 0; i < SegmentHeader::kRoots; ++i) {
+        first.Root<Node>(i).Reset();
+    }
+}
@@ -0,0 +1,199 @@
+#include "../shared.h"
+#include "../persistent_map.h"
+#include "../persistent_vector.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Sends every key to one of four hashes to exercise collision nodes
+struct BadHash {
+    size_t operator()(int key) const {
+        return key % 4;
+    }
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PersistentVector") {
+    SECTION("PushBack and lookup") {
+        PersistentVector<int> vec;
+        REQUIRE(vec.Empty());
+        for (int i = 0; i < 40000; ++i) {
+            vec = vec.PushBack(i);
+        }
+        REQUIRE(vec.Size() == 40000);
+        for (int i = 0; i < 40000; i += 7) {
+            REQUIRE(vec[i] == i);
+        }
+
+        int64_t sum = 0;
+        vec.ForEach([&](int value) { sum += value; });
+        REQUIRE(sum == int64_t(39999) * 40000 / 2);
+    }
+
+    SECTION("Old versions are untouched") {
+        PersistentVector<std::string> v1;
+        for (int i = 0; i < 100; ++i) {
+            v1 = v1.PushBack(std::to_string(i));
+        }
+        auto v2 = v1.Set(50, "fifty");
+        auto v3 = v2.PushBack("last");
+
+        REQUIRE(v1[50] == "50");
+        REQUIRE(v2[50] == "fifty");
+        REQUIRE(v1.Size() == 100);
+        REQUIRE(v2.Size() == 100);
+        REQUIRE(v3.Size() == 101);
+        REQUIRE(v3[100] == "last");
+        REQUIRE(&v1[0] == &v3[0]);
+    }
+
+    SECTION("Transient updates mutate in place") {
+        PersistentVector<int> vec;
+        for (int i = 0; i < 1000; ++i) {
+            vec = std::move(vec).PushBack(i);
+        }
+        const int* before = &vec[500];
+        vec = std::move(vec).Set(500, -1);
+        REQUIRE(&vec[500] == before);
+        REQUIRE(vec[500] == -1);
+
+        auto snapshot = vec;
+        vec = std::move(vec).Set(500, -2);
+        REQUIRE(&vec[500] != before);
+        REQUIRE(snapshot[500] == -1);
+        REQUIRE(vec[500] == -2);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PersistentMap") {
+    SECTION("Set, find, erase") {
+        PersistentMap<std::string, int> map;
+        for (int i = 0; i < 10000; ++i) {
+            map = map.Set(std::to_string(i), i);
+        }
+        REQUIRE(map.Size() == 10000);
+        REQUIRE(*map.Find("1234") == 1234);
+        REQUIRE(!map.Find("abacaba"));
+
+        map = map.Set("1234", -1);
+        REQUIRE(map.Size() == 10000);
+        REQUIRE(*map.Find("1234") == -1);
+
+        for (int i = 0; i < 10000; i += 2) {
+            map = map.Erase(std::to_string(i));
+        }
+        REQUIRE(map.Size() == 5000);
+        REQUIRE(!map.Contains("1234"));
+        REQUIRE(map.Contains("1235"));
+        map = map.Erase("1234");
+        REQUIRE(map.Size() == 5000);
+    }
+
+    SECTION("Old versions are untouched") {
+        PersistentMap<int, std::string> m1;
+        for (int i = 0; i < 100; ++i) {
+            m1 = m1.Set(i, "v1");
+        }
+        auto m2 = m1.Set(5, "v2").Erase(6);
+
+        REQUIRE(*m1.Find(5) == "v1");
+        REQUIRE(m1.Contains(6));
+        REQUIRE(*m2.Find(5) == "v2");
+        REQUIRE(!m2.Contains(6));
+        REQUIRE(m1.Find(7) == m2.Find(7));
+    }
+
+    SECTION("Hash collisions") {
+        PersistentMap<int, int, BadHash> map;
+        for (int i = 0; i < 100; ++i) {
+            map = std::move(map).Set(i, i * i);
+        }
+        REQUIRE(map.Size() == 100);
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(*map.Find(i) == i * i);
+        }
+        auto erased = map.Erase(42);
+        REQUIRE(!erased.Contains(42));
+        REQUIRE(map.Contains(42));
+        for (int i = 0; i < 100; ++i) {
+            erased = std::move(erased).Erase(i);
+        }
+        REQUIRE(erased.Empty());
+    }
+
+    SECTION("Transient updates mutate in place") {
+        PersistentMap<int, int> map;
+        for (int i = 0; i < 1000; ++i) {
+            map = std::move(map).Set(i, i);
+        }
+        const int* before = map.Find(500);
+        map = std::move(map).Set(500, -1);
+        REQUIRE(map.Find(500) == before);
+
+        auto snapshot = map;
+        map = std::move(map).Set(500, -2);
+        REQUIRE(*snapshot.Find(500) == -1);
+        REQUIRE(*map.Find(500) == -2);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Persistent vs copying snapshots", "[.bench]") {
+    constexpr int kSize = 1 << 16;
+    constexpr int kUpdates = 1 << 10;
+    // Snapshots kept alive at any moment
+    constexpr int kKept = 16;
+
+    std::vector<int> vector(kSize);
+    PersistentVector<int> persistent_vector;
+    std::unordered_map<int, int> map;
+    PersistentMap<int, int> persistent_map;
+    for (int i = 0; i < kSize; ++i) {
+        persistent_vector = std::move(persistent_vector).PushBack(i);
+        map[i] = i;
+        persistent_map = std::move(persistent_map).Set(i, i);
+    }
+
+    ReportBench("std::vector copy per update", MeasureSeconds([&] {
+                    std::vector<std::vector<int>> snapshots(kKept);
+                    for (int i = 0; i < kUpdates; ++i) {
+                        snapshots[i % kKept] = vector;
+                        vector[i] = -i;
+                    }
+                }));
+    ReportBench("PersistentVector::Set", MeasureSeconds([&] {
+                    std::vector<PersistentVector<int>> snapshots(kKept);
+                    for (int i = 0; i < kUpdates; ++i) {
+                        snapshots[i % kKept] = persistent_vector;
+                        persistent_vector = persistent_vector.Set(i, -i);
+                    }
+                }));
+    ReportBench("std::unordered_map copy per update", MeasureSeconds([&] {
+                    std::vector<std::unordered_map<int, int>> snapshots(kKept);
+                    for (int i = 0; i < kUpdates; ++i) {
+                        snapshots[i % kKept] = map;
+                        map[i] = -i;
+                    }
+                }));
+    ReportBench("PersistentMap::Set", MeasureSeconds([&] {
+                    std::vector<PersistentMap<int, int>> snapshots(kKept);
+                    for (int i = 0; i < kUpdates; ++i) {
+                        snapshots[i % kKept] = persistent_map;
+                        persistent_map = persistent_map.Set(i, -i);
+                    }
+                }));
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Immutable hash map: a hash array mapped trie of `SharedPtr` nodes, 32-way per level. Like
+// `PersistentVector`, updates copy only the path to the changed entry, and the `&&` overloads
+// mutate nodes owned alone in place.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class PersistentMap {
+public:
+    static constexpr size_t kBits = 5;
+    static constexpr size_t kMask = (size_t(1) << kBits) - 1;
+    // Past this shift all hash bits are used up and colliding keys share a plain list
+    static constexpr size_t kMaxShift = sizeof(size_t) * 8;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    PersistentMap Set(K key, V value) const& {
+        PersistentMap copy(*this);
+        return std::move(copy).Set(std::move(key), std::move(value));
+    }
+    PersistentMap Set(K key, V value) && {
+        size_t hash = Hash()(key);
+        if (Insert(root_, 0, hash, std::move(key), std::move(value))) {
+            size_++;
+        }
+        return std::move(*this);
+    }
+
+    PersistentMap Erase(const K& key) const& {
+        if (!Find(key)) {
+            return *this;
+        }
+        PersistentMap copy(*this);
+        return std::move(copy).Erase(key);
+    }
+    PersistentMap Erase(const K& key) && {
+        if (root_ && Remove(root_, 0, Hash()(key), key)) {
+            size_--;
+        }
+        return std::move(*this);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const V* Find(const K& key) const {
+        size_t hash = Hash()(key);
+        const Node* node = root_.Get();
+        for (size_t shift = 0; node; shift += kBits) {
+            if (shift >= kMaxShift) {
+                for (const auto& entry : node->entries) {
+                    if (entry.first == key) {
+                        return &entry.second;
+                    }
+                }
+                return nullptr;
+            }
+            uint32_t bit = Bit(hash, shift);
+            if (node->datamap & bit) {
+                const auto& entry = node->entries[Index(node->datamap, bit)];
+                return entry.first == key ? &entry.second : nullptr;
+            }
+            if (!(node->nodemap & bit)) {
+                return nullptr;
+            }
+            node = node->children[Index(node->nodemap, bit)].Get();
+        }
+        return nullptr;
+    }
+    bool Contains(const K& key) const {
+        return Find(key) != nullptr;
+    }
+    size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+private:
+    // `entries` are indexed by the set bits of `datamap`, `children` by those of `nodemap`.
+    // Collision nodes (below `kMaxShift`) keep every entry in `entries` and use no bitmaps.
+    struct Node {
+        uint32_t datamap = 0;
+        uint32_t nodemap = 0;
+        std::vector<std::pair<K, V>> entries;
+        std::vector<SharedPtr<Node>> children;
+    };
+
+    static uint32_t Bit(size_t hash, size_t shift) {
+        return uint32_t(1) << ((hash >> shift) & kMask);
+    }
+    static size_t Index(uint32_t bitmap, uint32_t bit) {
+        return __builtin_popcount(bitmap & (bit - 1));
+    }
+
+    static Node& Editable(SharedPtr<Node>& node) {
+        if (!node) {
+            node = MakeShared<Node>();
+        } else if (node.UseCount() > 1) {
+            node = MakeShared<Node>(std::as_const(*node));
+        }
+        return *node;
+    }
+
+    // Returns whether the key is new
+    static bool Insert(SharedPtr<Node>& slot, size_t shift, size_t hash, K&& key, V&& value) {
+        Node& node = Editable(slot);
+        if (shift >= kMaxShift) {
+            for (auto& entry : node.entries) {
+                if (entry.first == key) {
+                    entry.second = std::move(value);
+                    return false;
+                }
+            }
+            node.entries.emplace_back(std::move(key), std::move(value));
+            return true;
+        }
+
+        uint32_t bit = Bit(hash, shift);
+        if (node.datamap & bit) {
+            size_t ind = Index(node.datamap, bit);
+            if (node.entries[ind].first == key) {
+                node.entries[ind].second = std::move(value);
+                return false;
+            }
+            // Push both entries one level down
+            auto old = std::move(node.entries[ind]);
+            node.entries.erase(node.entries.begin() + ind);
+            node.datamap &= ~bit;
+
+            SharedPtr<Node> child;
+            size_t old_hash = Hash()(old.first);
+            Insert(child, shift + kBits, old_hash, std::move(old.first), std::move(old.second));
+            Insert(child, shift + kBits, hash, std::move(key), std::move(value));
+
+            node.children.insert(node.children.begin() + Index(node.nodemap, bit),
+                                 std::move(child));
+            node.nodemap |= bit;
+            return true;
+        }
+        if (node.nodemap & bit) {
+            return Insert(node.children[Index(node.nodemap, bit)], shift + kBits, hash,
+                          std::move(key), std::move(value));
+        }
+        node.entries.emplace(node.entries.begin() + Index(node.datamap, bit), std::move(key),
+                             std::move(value));
+        node.datamap |= bit;
+        return true;
+    }
+
+    // Returns whether the key was there
+    static bool Remove(SharedPtr<Node>& slot, size_t shift, size_t hash, const K& key) {
+        if (shift >= kMaxShift) {
+            auto& entries = Editable(slot).entries;
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (entries[i].first == key) {
+                    entries.erase(entries.begin() + i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        uint32_t bit = Bit(hash, shift);
+        if (slot->datamap & bit) {
+            size_t ind = Index(slot->datamap, bit);
+            if (!(slot->entries[ind].first == key)) {
+                return false;
+            }
+            Node& node = Editable(slot);
+            node.entries.erase(node.entries.begin() + ind);
+            node.datamap &= ~bit;
+            return true;
+        }
+        if (!(slot->nodemap & bit)) {
+            return false;
+        }
+
+        Node& node = Editable(slot);
+        size_t ind = Index(node.nodemap, bit);
+        if (!Remove(node.children[ind], shift + kBits, hash, key)) {
+            return false;
+        }
+        // Pull a lone remaining entry back up, drop an empty child
+        Node& child = *node.children[ind];
+        if (child.children.empty() && child.entries.size() <= 1) {
+            if (child.entries.size() == 1) {
+                node.entries.insert(node.entries.begin() + Index(node.datamap, bit),
+                                    std::move(child.entries.front()));
+                node.datamap |= bit;
+            }
+            node.children.erase(node.children.begin() + ind);
+            node.nodemap &= ~bit;
+        }
+        return true;
+    }
+
+    SharedPtr<Node> root_;
+    size_t size_ = 0;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Immutable vector: a 32-way radix tree of `SharedPtr` nodes. An update copies only the
+// O(log n) nodes on the path to the changed element and shares the rest with the original.
+//
+// The `&&` overloads are the transient (batch) form: called on an rvalue, they mutate every
+// node that this vector owns alone (`UseCount() == 1`) in place instead of copying it, e.g.
+// `vec = std::move(vec).PushBack(x)`.
+template <typename T>
+class PersistentVector {
+public:
+    static constexpr size_t kBits = 5;
+    static constexpr size_t kWidth = size_t(1) << kBits;
+    static constexpr size_t kMask = kWidth - 1;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Updates
+
+    PersistentVector Set(size_t ind, T value) const& {
+        PersistentVector copy(*this);
+        return std::move(copy).Set(ind, std::move(value));
+    }
+    PersistentVector Set(size_t ind, T value) && {
+        SharedPtr<Node>* slot = &root_;
+        for (size_t shift = shift_; shift > 0; shift -= kBits) {
+            Node& node = Editable(*slot);
+            slot = &node.children[(ind >> shift) & kMask];
+        }
+        Editable(*slot).values[ind & kMask] = std::move(value);
+        return std::move(*this);
+    }
+
+    PersistentVector PushBack(T value) const& {
+        PersistentVector copy(*this);
+        return std::move(copy).PushBack(std::move(value));
+    }
+    PersistentVector PushBack(T value) && {
+        if (!root_) {
+            root_ = MakeShared<Node>();
+        } else if (size_ == size_t(1) << (shift_ + kBits)) {
+            // Root is full: grow the tree by one level
+            auto root = MakeShared<Node>();
+            root->children.push_back(std::move(root_));
+            root_ = std::move(root);
+            shift_ += kBits;
+        }
+
+        SharedPtr<Node>* slot = &root_;
+        for (size_t shift = shift_; shift > 0; shift -= kBits) {
+            Node& node = Editable(*slot);
+            size_t child = (size_ >> shift) & kMask;
+            if (child == node.children.size()) {
+                node.children.push_back(MakeShared<Node>());
+            }
+            slot = &node.children[child];
+        }
+        Editable(*slot).values.push_back(std::move(value));
+        size_++;
+        return std::move(*this);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    const T& operator[](size_t ind) const {
+        const Node* node = root_.Get();
+        for (size_t shift = shift_; shift > 0; shift -= kBits) {
+            node = node->children[(ind >> shift) & kMask].Get();
+        }
+        return node->values[ind & kMask];
+    }
+    size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    template <typename F>
+    void ForEach(F&& func) const {
+        if (root_) {
+            ForEach(*root_, shift_, func);
+        }
+    }
+
+private:
+    // Inner nodes only use `children`, leaves only use `values`
+    struct Node {
+        std::vector<SharedPtr<Node>> children;
+        std::vector<T> values;
+    };
+
+    static Node& Editable(SharedPtr<Node>& node) {
+        if (node.UseCount() > 1) {
+            node = MakeShared<Node>(std::as_const(*node));
+        }
+        return *node;
+    }
+
+    template <typename F>
+    static void ForEach(const Node& node, size_t shift, F& func) {
+        if (shift == 0) {
+            for (const auto& value : node.values) {
+                func(value);
+            }
+            return;
+        }
+        for (const auto& child : node.children) {
+            ForEach(*child, shift - kBits, func);
+        }
+    }
+
+    SharedPtr<Node> root_;
+    size_t size_ = 0;
+    size_t shift_ = 0;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+// Single value that one thread publishes and many threads read. Readers go through a
+// `Reader`, which caches its own copy of the current `SharedPtr` and refreshes it only when
+// the generation changes: the hot read is a relaxed load and a comparison, with no refcount
+// traffic at all.
+//
+// `BlockBase` counters are plain ints, so every count change on a published block happens
+// under `mutex_`: publishing, refreshing a cache and dropping it.
+template <typename T>
+class Published {
+public:
+    class Reader {
+    public:
+        explicit Reader(const Published& source) : source_(&source) {
+            Refresh();
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        ~Reader() {
+            std::lock_guard lock(source_->mutex_);
+            cached_.Reset();
+        }
+
+        // Valid until the next call on this reader
+        const T& Get() {
+            if (source_->generation_.load(std::memory_order_relaxed) != seen_) {
+                Refresh();
+            }
+            return *cached_;
+        }
+        const T& operator*() {
+            return Get();
+        }
+        const T* operator->() {
+            return &Get();
+        }
+        uint64_t Generation() const {
+            return seen_;
+        }
+
+    private:
+        void Refresh() {
+            std::lock_guard lock(source_->mutex_);
+            cached_ = source_->current_;
+            seen_ = source_->generation_.load(std::memory_order_relaxed);
+        }
+
+        const Published* source_;
+        SharedPtr<T> cached_;
+        uint64_t seen_ = 0;
+    };
+
+    explicit Published(SharedPtr<T> value) : current_(std::move(value)) {
+    }
+    Published(const Published&) = delete;
+    Published& operator=(const Published&) = delete;
+
+    // Hand over the only reference to `value`: copies kept by the writer would change the
+    // count outside of `mutex_`
+    void Publish(SharedPtr<T> value) {
+        std::lock_guard lock(mutex_);
+        current_ = std::move(value);
+        generation_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t Generation() const {
+        return generation_.load(std::memory_order_relaxed);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    SharedPtr<T> current_;
+    std::atomic<uint64_t> generation_ = 0;
+};
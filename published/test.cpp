@@ -0,0 +1,111 @@
+#include "../shared.h"
+#include "../published.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Config {
+    int version;
+    std::string name;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Published") {
+    SECTION("Readers see new versions") {
+        Published<Config> config(MakeShared<Config>(Config{1, "first"}));
+        Published<Config>::Reader reader(config);
+        REQUIRE(reader->version == 1);
+        const Config* cached = &reader.Get();
+        REQUIRE(&reader.Get() == cached);
+
+        config.Publish(MakeShared<Config>(Config{2, "second"}));
+        REQUIRE(config.Generation() == 1);
+        REQUIRE(reader->name == "second");
+        REQUIRE(reader.Generation() == 1);
+    }
+
+    SECTION("Readers keep old versions alive") {
+        auto first = MakeShared<Config>(Config{1, "first"});
+        Config* raw = first.Get();
+        Published<Config> config(std::move(first));
+        {
+            Published<Config>::Reader reader(config);
+            config.Publish(MakeShared<Config>(Config{2, "second"}));
+            REQUIRE(raw->version == 1);
+            REQUIRE((*reader).version == 2);
+        }
+    }
+
+    SECTION("Concurrent readers") {
+        Published<Config> config(MakeShared<Config>(Config{0, "0"}));
+        std::atomic<bool> done = false;
+        std::atomic<bool> monotonic = true;
+
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&] {
+                Published<Config>::Reader reader(config);
+                int last = 0;
+                while (!done) {
+                    const Config& current = reader.Get();
+                    if (current.version < last || std::to_string(current.version) != current.name) {
+                        monotonic = false;
+                    }
+                    last = current.version;
+                }
+            });
+        }
+        for (int i = 1; i <= 1000; ++i) {
+            config.Publish(MakeShared<Config>(Config{i, std::to_string(i)}));
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        REQUIRE(monotonic);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Published reads vs locked copies", "[.bench]") {
+    constexpr int kReads = 1 << 24;
+
+    std::mutex mutex;
+    auto shared = MakeShared<Config>(Config{1, "config"});
+    int64_t sum = 0;
+    ReportBench("lock + copy SharedPtr", MeasureSeconds([&] {
+                    for (int i = 0; i < kReads; ++i) {
+                        SharedPtr<Config> copy;
+                        {
+                            std::lock_guard lock(mutex);
+                            copy = shared;
+                        }
+                        sum += copy->version;
+                        std::lock_guard lock(mutex);
+                        copy.Reset();
+                    }
+                }));
+
+    Published<Config> config(MakeShared<Config>(Config{1, "config"}));
+    Published<Config>::Reader reader(config);
+    ReportBench("Published::Reader::Get", MeasureSeconds([&] {
+                    for (int i = 0; i < kReads; ++i) {
+                        sum += reader->version;
+                    }
+                }));
+    DoNotOptimize(sum);
+}
@@ -2,6 +2,7 @@
 
 #include "sw_fwd.h"  // Forward declaration
 
+#include <cassert>
 #include <cstddef>  // std::nullptr_t
 #include <memory>
 #include <type_traits>
@@ -14,9 +15,60 @@ public:
     virtual ~BlockBase() = default;
     virtual void Destruct() {
     }
+    // Free the block itself once both counters are zero
+    virtual void Deallocate() {
+        delete this;
+    }
+    // A reference was dropped and others remain: the block may sit on a garbage cycle. Only
+    // called on `traced_` blocks, i.e. the collectable ones (cycle.h).
+    virtual void Suspect() {
+    }
+
+    // Drop `count` strong references at once, destroying the object with the last one
+    void ReleaseStrong(int count = 1) {
+        strong_ -= count;
+        if (strong_ > 0) {
+            if (traced_) {
+                Suspect();
+            }
+        } else if (strong_ == 0) {
+#ifdef SHARED_REF_CHECKS
+            assert(borrowed_ == 0 && "SharedRef outlived its owner");
+#endif
+            AddWeak();
+            Destruct();
+            if (hooked_) {
+                fire_expire_(this);
+            }
+            weak_--;
+            if (weak_ == 0) {
+                Deallocate();
+            }
+        }
+    }
+
+    // `weak_` gives two bits to the flags below, so its increments are checked
+    void AddWeak() {
+        assert(weak_ < kMaxWeak && "Too many weak references");
+        weak_++;
+    }
+
+    static constexpr int kMaxWeak = (1 << 29) - 1;
 
     int strong_ = 0;
-    int weak_ = 0;
+    int weak_ : 30 = 0;
+    // Has expiration callbacks (see expire.h); shares the word with `weak_`
+    unsigned hooked_ : 1 = 0;
+    // Collectable block that wants `Suspect()` on every release that leaves it alive
+    unsigned traced_ : 1 = 0;
+#ifdef SHARED_REF_CHECKS
+    // Number of live `SharedRef`-s borrowing this block (see shared_ref.h). The macro changes
+    // the block layout, so it must be set the same way in every translation unit.
+    int borrowed_ = 0;
+#endif
+
+    // Runs the callbacks of a `hooked_` block; set by expire.h, the only place that sets the bit
+    static inline void (*fire_expire_)(BlockBase* block) = nullptr;
 };
 
 template <typename T>
@@ -199,15 +251,7 @@ public:
 
     void Reset() {
         if (block_) {
-            block_->strong_--;
-            if (block_->strong_ == 0) {
-                block_->weak_++;
-                block_->Destruct();
-                block_->weak_--;
-                if (block_->weak_ == 0) {
-                    delete block_;
-                }
-            }
+            block_->ReleaseStrong();
         }
 
         block_ = nullptr;
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Write `n` owners of `ptr` to `out`, bumping `strong_` once instead of `n` times. Throws
+// `std::overflow_error` if the counter can't hold `n` more references.
+template <typename T, typename OutputIt>
+OutputIt RetainN(const SharedPtr<T>& ptr, size_t n, OutputIt out) {
+    if (n == 0) {
+        return out;
+    }
+    if (ptr.block_) {
+        if (n > static_cast<size_t>(std::numeric_limits<int>::max() - ptr.block_->strong_)) {
+            throw std::overflow_error("RetainN: too many references for the counter");
+        }
+        ptr.block_->strong_ += static_cast<int>(n);
+    }
+    size_t made = 0;
+    try {
+        while (made < n) {
+            SharedPtr<T> owner;
+            owner.block_ = ptr.block_;
+            owner.ptr_ = ptr.ptr_;
+            ++made;
+            *out = std::move(owner);
+            ++out;
+        }
+    } catch (...) {
+        // Owners already made release their own reference; the rest were never handed out
+        if (ptr.block_) {
+            ptr.block_->strong_ -= static_cast<int>(n - made);
+        }
+        throw;
+    }
+    return out;
+}
+
+// Open-addressing multiset of control blocks used by `ReleaseBatch`
+class BlockTally {
+public:
+    void Add(BlockBase* block, int count) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            Grow();
+        }
+        Insert(block, count);
+    }
+
+    template <typename F>
+    void ForEach(F&& func) {
+        for (const auto& slot : slots_) {
+            if (slot.block) {
+                func(slot.block, slot.count);
+            }
+        }
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    struct Slot {
+        BlockBase* block = nullptr;
+        int count = 0;
+    };
+
+    size_t Index(BlockBase* block) const {
+        // Blocks are at least 16-byte aligned, so drop the always-zero bits first
+        return (reinterpret_cast<uintptr_t>(block) >> 4) * 0x9E3779B97F4A7C15ull >> shift_;
+    }
+
+    void Insert(BlockBase* block, int count) {
+        size_t mask = slots_.size() - 1;
+        for (size_t i = Index(block);; i = (i + 1) & mask) {
+            if (slots_[i].block == block) {
+                slots_[i].count += count;
+                return;
+            }
+            if (!slots_[i].block) {
+                slots_[i] = {block, count};
+                size_++;
+                return;
+            }
+        }
+    }
+
+    void Grow() {
+        std::vector<Slot> old(slots_.empty() ? 32 : slots_.size() * 2);
+        old.swap(slots_);
+        shift_ = 64 - __builtin_ctzll(slots_.size());
+        size_ = 0;
+        for (const auto& slot : old) {
+            if (slot.block) {
+                Insert(slot.block, slot.count);
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+    int shift_ = 64;
+};
+
+// Reset every pointer in `ptrs`, applying one decrement per distinct control block
+template <typename T>
+void ReleaseBatch(std::span<SharedPtr<T>> ptrs) {
+    BlockTally tally;
+    BlockBase* last = nullptr;
+    int run = 0;
+    for (auto& ptr : ptrs) {
+        // Fan-out batches tend to hold runs of the same block, so count those without hashing
+        if (ptr.block_ != last) {
+            if (run > 0) {
+                tally.Add(last, run);
+            }
+            last = ptr.block_;
+            run = 0;
+        }
+        if (last) {
+            run++;
+        }
+        ptr.block_ = nullptr;
+        ptr.ptr_ = nullptr;
+    }
+    if (run > 0) {
+        tally.Add(last, run);
+    }
+
+    std::vector<std::pair<BlockBase*, int>> releases;
+    releases.reserve(tally.Size());
+    tally.ForEach([&](BlockBase* block, int count) { releases.emplace_back(block, count); });
+
+    constexpr size_t kPrefetchDistance = 8;
+    for (size_t i = 0; i < releases.size() && i < kPrefetchDistance; ++i) {
+        __builtin_prefetch(releases[i].first, 1);
+    }
+    for (size_t i = 0; i < releases.size(); ++i) {
+        if (i + kPrefetchDistance < releases.size()) {
+            __builtin_prefetch(releases[i + kPrefetchDistance].first, 1);
+        }
+        releases[i].first->ReleaseStrong(releases[i].second);
+    }
+}
+
+template <typename T>
+void ReleaseBatch(std::vector<SharedPtr<T>>& ptrs) {
+    ReleaseBatch(std::span<SharedPtr<T>>(ptrs));
+}
@@ -0,0 +1,171 @@
+#include "../shared.h"
+#include "../shared_batch.h"
+#include "../weak.h"
+#include "../my_int.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("RetainN") {
+    SECTION("Fan-out") {
+        auto ptr = MakeShared<MyInt>(7);
+        std::vector<SharedPtr<MyInt>> queue;
+        RetainN(ptr, 100, std::back_inserter(queue));
+
+        REQUIRE(queue.size() == 100);
+        REQUIRE(ptr.UseCount() == 101);
+        REQUIRE(*queue[42] == 7);
+
+        queue.clear();
+        REQUIRE(ptr.UseCount() == 1);
+        ptr.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Into existing slots") {
+        auto ptr = MakeShared<int>(1);
+        std::vector<SharedPtr<int>> slots(10);
+        auto end = RetainN(ptr, 5, slots.begin());
+
+        REQUIRE(end == slots.begin() + 5);
+        REQUIRE(ptr.UseCount() == 6);
+        REQUIRE(slots[5].Get() == nullptr);
+    }
+
+    SECTION("Empty") {
+        SharedPtr<int> ptr;
+        std::deque<SharedPtr<int>> queue;
+        RetainN(ptr, 3, std::back_inserter(queue));
+
+        REQUIRE(queue.size() == 3);
+        REQUIRE(queue[0].Get() == nullptr);
+        REQUIRE(queue[0].UseCount() == 0);
+    }
+
+    SECTION("Counter overflow") {
+        auto ptr = MakeShared<int>(1);
+        std::vector<SharedPtr<int>> out;
+        REQUIRE_THROWS_AS(RetainN(ptr, std::numeric_limits<int>::max(), std::back_inserter(out)),
+                          std::overflow_error);
+        REQUIRE(out.empty());
+        REQUIRE(ptr.UseCount() == 1);
+    }
+
+    SECTION("Output throws") {
+        struct Full {};
+        struct ThrowingOutput {
+            ThrowingOutput& operator*() {
+                return *this;
+            }
+            ThrowingOutput& operator++() {
+                return *this;
+            }
+            ThrowingOutput& operator=(SharedPtr<MyInt>&& owner) {
+                if (slots->size() == 3) {
+                    throw Full();
+                }
+                slots->push_back(std::move(owner));
+                return *this;
+            }
+
+            std::vector<SharedPtr<MyInt>>* slots;
+        };
+
+        auto ptr = MakeShared<MyInt>(7);
+        std::vector<SharedPtr<MyInt>> slots;
+        REQUIRE_THROWS_AS(RetainN(ptr, 10, ThrowingOutput{&slots}), Full);
+        REQUIRE(slots.size() == 3);
+        REQUIRE(ptr.UseCount() == 4);
+
+        slots.clear();
+        REQUIRE(ptr.UseCount() == 1);
+        ptr.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ReleaseBatch") {
+    SECTION("Groups by control block") {
+        auto a = MakeShared<MyInt>(1);
+        auto b = MakeShared<MyInt>(2);
+        std::vector<SharedPtr<MyInt>> batch;
+        for (int i = 0; i < 10; ++i) {
+            batch.push_back(i % 2 ? a : b);
+        }
+        batch.push_back(nullptr);
+        batch.push_back(MakeShared<MyInt>(3));
+        REQUIRE(MyInt::AliveCount() == 3);
+
+        ReleaseBatch(batch);
+
+        REQUIRE(MyInt::AliveCount() == 2);
+        REQUIRE(a.UseCount() == 1);
+        REQUIRE(b.UseCount() == 1);
+        for (const auto& ptr : batch) {
+            REQUIRE(ptr.Get() == nullptr);
+        }
+    }
+
+    SECTION("Last owners") {
+        std::vector<SharedPtr<MyInt>> batch;
+        WeakPtr<MyInt> weak;
+        {
+            auto ptr = MakeShared<MyInt>(1);
+            weak = ptr;
+            RetainN(ptr, 5, std::back_inserter(batch));
+        }
+        ReleaseBatch(std::span<SharedPtr<MyInt>>(batch));
+
+        REQUIRE(weak.Expired());
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Empty batch") {
+        std::vector<SharedPtr<int>> batch;
+        ReleaseBatch(batch);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Batch vs one-at-a-time", "[.bench]") {
+    constexpr size_t kCopies = 1 << 20;
+    constexpr size_t kBlocks = 16;
+
+    std::vector<SharedPtr<int>> sources;
+    for (size_t i = 0; i < kBlocks; ++i) {
+        sources.push_back(MakeShared<int>(i));
+    }
+
+    std::vector<SharedPtr<int>> queue;
+    queue.reserve(kCopies);
+    ReportBench("copy one-at-a-time", MeasureSeconds([&] {
+                    for (size_t i = 0; i < kCopies; ++i) {
+                        queue.push_back(sources[i % kBlocks]);
+                    }
+                }));
+    ReportBench("destroy one-at-a-time", MeasureSeconds([&] { queue.clear(); }));
+
+    ReportBench("RetainN", MeasureSeconds([&] {
+                    for (const auto& source : sources) {
+                        RetainN(source, kCopies / kBlocks, std::back_inserter(queue));
+                    }
+                }));
+    ReportBench("ReleaseBatch (runs)", MeasureSeconds([&] { ReleaseBatch(queue); }));
+
+    for (size_t i = 0; i < kCopies; ++i) {
+        queue[i] = sources[i % kBlocks];
+    }
+    ReportBench("ReleaseBatch (interleaved)", MeasureSeconds([&] { ReleaseBatch(queue); }));
+    DoNotOptimize(queue);
+}
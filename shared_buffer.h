@@ -0,0 +1,220 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+// Sibling of `BlockObject` for runtime-sized byte arrays: the counters and `size` bytes share
+// one allocation, with the bytes right behind the block.
+class BlockBytes : public BlockBase {
+public:
+    static BlockBytes* Create(size_t size) {
+        if (size > SIZE_MAX - sizeof(BlockBytes)) {
+            throw std::bad_array_new_length();
+        }
+        void* memory = ::operator new(sizeof(BlockBytes) + size);
+        return new (memory) BlockBytes(size);
+    }
+
+    void Deallocate() override {
+        this->~BlockBytes();
+        ::operator delete(this);
+    }
+
+    std::byte* GetPtr() {
+        return reinterpret_cast<std::byte*>(this + 1);
+    }
+
+    size_t size_;
+
+private:
+    explicit BlockBytes(size_t size) : size_(size) {
+    }
+};
+
+// Refcounted view of bytes. Copies and `Slice()`-s share the underlying allocation through the
+// aliasing constructor, so passing a payload between layers never copies it.
+class SharedBuffer {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SharedBuffer() {
+    }
+    SharedBuffer(SharedPtr<std::byte> data, size_t size) : data_(std::move(data)), size_(size) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        data_.Reset();
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // `length` bytes starting at `offset`, sharing ownership with this buffer. Throws
+    // `std::out_of_range` if they do not all lie within the buffer.
+    SharedBuffer Slice(size_t offset, size_t length) const {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::out_of_range("SharedBuffer: slice past the end of the buffer");
+        }
+        return SharedBuffer(SharedPtr<std::byte>(data_, data_.Get() + offset), length);
+    }
+    SharedBuffer Slice(size_t offset) const {
+        return Slice(offset, size_ - offset);
+    }
+
+    std::byte* Data() const {
+        return data_.Get();
+    }
+    size_t Size() const {
+        return size_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+    std::span<std::byte> Span() const {
+        return {data_.Get(), size_};
+    }
+    std::string_view View() const {
+        return {reinterpret_cast<const char*>(data_.Get()), size_};
+    }
+    // Buffers and slices alive on the same allocation
+    size_t UseCount() const {
+        return data_.UseCount();
+    }
+
+    // Fields
+    SharedPtr<std::byte> data_;
+    size_t size_ = 0;
+};
+
+// One allocation holding the counters and `size` uninitialized bytes
+inline SharedBuffer MakeSharedBuffer(size_t size) {
+    auto block = BlockBytes::Create(size);
+    SharedPtr<std::byte> data;
+    data.block_ = block;
+    data.ptr_ = block->GetPtr();
+    return SharedBuffer(std::move(data), size);
+}
+
+inline SharedBuffer MakeSharedBuffer(std::string_view bytes) {
+    auto res = MakeSharedBuffer(bytes.size());
+    std::memcpy(res.Data(), bytes.data(), bytes.size());
+    return res;
+}
+
+// Sequence of buffers sent or received as a whole by `writev`/`readv` without gathering them
+// into one place. `Iovecs()` stays in sync with the buffers, and `Consume()` drops bytes from the
+// front after a partial write.
+class BufferChain {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Append(SharedBuffer buffer) {
+        if (buffer.Empty()) {
+            return;
+        }
+        // The chain owns the buffer before any iovec points into it
+        buffers_.push_back(std::move(buffer));
+        const SharedBuffer& back = buffers_.back();
+        try {
+            iovecs_.push_back({back.Data(), back.Size()});
+        } catch (...) {
+            buffers_.pop_back();
+            throw;
+        }
+        size_ += back.Size();
+    }
+    // `other` may be this chain: only the buffers it had on entry are appended
+    void Append(const BufferChain& other) {
+        size_t end = other.buffers_.size();
+        for (size_t i = other.first_; i < end; ++i) {
+            Append(other.buffers_[i]);
+        }
+    }
+
+    // Drop the first `count` bytes, e.g. the ones a `writev` managed to write. Throws
+    // `std::out_of_range`, leaving the chain as it was, if it holds fewer bytes.
+    void Consume(size_t count) {
+        if (count > size_) {
+            throw std::out_of_range("BufferChain: consuming more bytes than the chain holds");
+        }
+        size_ -= count;
+        while (count > 0) {
+            SharedBuffer& front = buffers_[first_];
+            if (count < front.Size()) {
+                front = front.Slice(count);
+                iovecs_[first_] = {front.Data(), front.Size()};
+                return;
+            }
+            count -= front.Size();
+            front.Reset();
+            ++first_;
+        }
+        if (first_ * 2 >= buffers_.size()) {
+            Compact();
+        }
+    }
+    void Clear() {
+        buffers_.clear();
+        iovecs_.clear();
+        first_ = 0;
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // For `writev`/`readv`; callers split at `IOV_MAX` themselves
+    std::span<const iovec> Iovecs() const {
+        return {iovecs_.data() + first_, iovecs_.size() - first_};
+    }
+    // Total bytes
+    size_t Size() const {
+        return size_;
+    }
+    // Number of buffers
+    size_t Count() const {
+        return buffers_.size() - first_;
+    }
+    const SharedBuffer& operator[](size_t i) const {
+        return buffers_[first_ + i];
+    }
+
+    // Gather everything into one new buffer
+    SharedBuffer Flatten() const {
+        auto res = MakeSharedBuffer(size_);
+        size_t offset = 0;
+        for (size_t i = first_; i < buffers_.size(); ++i) {
+            std::memcpy(res.Data() + offset, buffers_[i].Data(), buffers_[i].Size());
+            offset += buffers_[i].Size();
+        }
+        return res;
+    }
+
+private:
+    void Compact() {
+        buffers_.erase(buffers_.begin(), buffers_.begin() + first_);
+        iovecs_.erase(iovecs_.begin(), iovecs_.begin() + first_);
+        first_ = 0;
+    }
+
+    std::vector<SharedBuffer> buffers_;
+    std::vector<iovec> iovecs_;
+    size_t first_ = 0;
+    size_t size_ = 0;
+};
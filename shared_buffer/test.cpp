@@ -0,0 +1,189 @@
+#include "../shared.h"
+#include "../shared_buffer.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedBuffer") {
+    SECTION("One allocation") {
+        auto buffer = MakeSharedBuffer("abacaba");
+        REQUIRE(buffer.Size() == 7);
+        REQUIRE(buffer.View() == "abacaba");
+        auto block = static_cast<BlockBytes*>(buffer.data_.block_);
+        REQUIRE(buffer.Data() == block->GetPtr());
+        REQUIRE(reinterpret_cast<char*>(buffer.Data()) ==
+                reinterpret_cast<char*>(block) + sizeof(BlockBytes));
+    }
+
+    SECTION("Slices share the allocation") {
+        SharedBuffer slice;
+        {
+            auto buffer = MakeSharedBuffer("header:payload");
+            slice = buffer.Slice(7);
+            REQUIRE(slice.Data() == buffer.Data() + 7);
+            REQUIRE(buffer.UseCount() == 2);
+
+            auto inner = slice.Slice(1, 3);
+            REQUIRE(inner.View() == "ayl");
+            REQUIRE(buffer.UseCount() == 3);
+        }
+        REQUIRE(slice.UseCount() == 1);
+        REQUIRE(slice.View() == "payload");
+
+        std::memcpy(slice.Data(), "PAY", 3);
+        REQUIRE(slice.View() == "PAYload");
+    }
+
+    SECTION("Empty slices") {
+        auto buffer = MakeSharedBuffer("aba");
+        REQUIRE(buffer.Slice(3).Empty());
+        REQUIRE(MakeSharedBuffer(size_t{0}).Empty());
+    }
+
+    SECTION("Bad ranges") {
+        auto buffer = MakeSharedBuffer("abacaba");
+        REQUIRE_THROWS_AS(buffer.Slice(8), std::out_of_range);
+        REQUIRE_THROWS_AS(buffer.Slice(3, 5), std::out_of_range);
+        REQUIRE_THROWS_AS(buffer.Slice(1, SIZE_MAX), std::out_of_range);
+        REQUIRE(buffer.Slice(3, 4).View() == "caba");
+
+        REQUIRE_THROWS_AS(MakeSharedBuffer(SIZE_MAX - 8), std::bad_array_new_length);
+    }
+}
+
+TEST_CASE("BufferChain") {
+    SECTION("Iovecs follow the buffers") {
+        auto packet = MakeSharedBuffer("HEADbodyTAIL");
+        BufferChain chain;
+        chain.Append(packet.Slice(0, 4));
+        chain.Append(SharedBuffer());
+        chain.Append(packet.Slice(4, 4));
+        chain.Append(MakeSharedBuffer("!"));
+
+        REQUIRE(chain.Count() == 3);
+        REQUIRE(chain.Size() == 9);
+        auto iovecs = chain.Iovecs();
+        REQUIRE(iovecs.size() == 3);
+        REQUIRE(iovecs[1].iov_base == packet.Data() + 4);
+        REQUIRE(iovecs[1].iov_len == 4);
+        REQUIRE(chain.Flatten().View() == "HEADbody!");
+    }
+
+    SECTION("Consume after a partial write") {
+        BufferChain chain;
+        chain.Append(MakeSharedBuffer("aba"));
+        chain.Append(MakeSharedBuffer("caba"));
+        chain.Append(MakeSharedBuffer("daba"));
+
+        chain.Consume(5);
+        REQUIRE(chain.Size() == 6);
+        REQUIRE(chain.Count() == 2);
+        REQUIRE(chain[0].View() == "ba");
+        REQUIRE(chain.Iovecs()[0].iov_len == 2);
+        REQUIRE(chain.Flatten().View() == "badaba");
+
+        REQUIRE_THROWS_AS(chain.Consume(7), std::out_of_range);
+        REQUIRE(chain.Size() == 6);
+        REQUIRE(chain.Iovecs().size() == 2);
+
+        chain.Consume(6);
+        REQUIRE(chain.Count() == 0);
+        REQUIRE(chain.Iovecs().empty());
+        REQUIRE_THROWS_AS(chain.Consume(1), std::out_of_range);
+    }
+
+    SECTION("Append a chain") {
+        BufferChain chain;
+        chain.Append(MakeSharedBuffer("aba"));
+        chain.Append(MakeSharedBuffer("caba"));
+        chain.Append(MakeSharedBuffer("daba"));
+        chain.Consume(3);
+
+        BufferChain other;
+        other.Append(MakeSharedBuffer("x"));
+        other.Append(MakeSharedBuffer("yz"));
+        chain.Append(other);
+        REQUIRE(chain.Count() == 4);
+        REQUIRE(chain.Flatten().View() == "cabadabaxyz");
+
+        chain.Append(chain);
+        REQUIRE(chain.Count() == 8);
+        REQUIRE(chain.Size() == 22);
+        REQUIRE(chain.Flatten().View() == "cabadabaxyzcabadabaxyz");
+    }
+
+    SECTION("writev and readv through a pipe") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+
+        auto payload = MakeSharedBuffer("0123456789");
+        BufferChain out;
+        out.Append(MakeSharedBuffer("len=10;"));
+        out.Append(payload.Slice(0, 5));
+        out.Append(payload.Slice(5));
+        while (out.Size() > 0) {
+            auto iovecs = out.Iovecs();
+            auto written = writev(fds[1], iovecs.data(), static_cast<int>(iovecs.size()));
+            REQUIRE(written > 0);
+            out.Consume(written);
+        }
+
+        auto storage = MakeSharedBuffer(17);
+        BufferChain in;
+        in.Append(storage.Slice(0, 7));
+        in.Append(storage.Slice(7));
+        auto iovecs = in.Iovecs();
+        REQUIRE(readv(fds[0], iovecs.data(), static_cast<int>(iovecs.size())) == 17);
+        REQUIRE(in[0].View() == "len=10;");
+        REQUIRE(in[1].View() == "0123456789");
+
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedBuffer bench", "[.bench]") {
+    constexpr int kPackets = 1 << 14;
+    constexpr size_t kPacketSize = 4096;
+    constexpr size_t kHeader = 64;
+
+    // Three layers each strip a header and hand the rest on
+    std::vector<std::string> strings(kPackets, std::string(kPacketSize, 'x'));
+    ReportBench("std::string copies per layer", MeasureSeconds([&] {
+        for (auto& packet : strings) {
+            std::string layer = packet;
+            for (int i = 0; i < 3; ++i) {
+                layer = layer.substr(kHeader);
+            }
+            DoNotOptimize(layer.data());
+        }
+    }));
+
+    std::vector<SharedBuffer> buffers;
+    for (int i = 0; i < kPackets; ++i) {
+        buffers.push_back(MakeSharedBuffer(kPacketSize));
+    }
+    ReportBench("SharedBuffer slices per layer", MeasureSeconds([&] {
+        for (auto& packet : buffers) {
+            SharedBuffer layer = packet;
+            for (int i = 0; i < 3; ++i) {
+                layer = layer.Slice(kHeader);
+            }
+            DoNotOptimize(layer.Data());
+        }
+    }));
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "arena.h"
+#include "shared.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Control block owning a whole arena of objects. They are destroyed, in reverse order of
+// creation, and freed together when the last handle to any of them is gone.
+class BlockGroup : public BlockBase {
+public:
+    explicit BlockGroup(size_t chunk_size) : arena_(chunk_size) {
+    }
+
+    void Destruct() override {
+        while (finalizers_) {
+            finalizers_->destroy(finalizers_->object);
+            finalizers_ = finalizers_->next;
+        }
+        arena_.Release();
+    }
+
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            return arena_.Create<T>(std::forward<Args>(args)...);
+        } else {
+            // The record comes first: failing to allocate it must not strand a live `T`
+            auto finalizer = arena_.Create<Finalizer>(
+                Finalizer{[](void* ptr) { static_cast<T*>(ptr)->~T(); }, nullptr, finalizers_});
+            T* object = arena_.Create<T>(std::forward<Args>(args)...);
+            finalizer->object = object;
+            finalizers_ = finalizer;
+            return object;
+        }
+    }
+
+    Arena arena_;
+
+private:
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    Finalizer* finalizers_ = nullptr;
+};
+
+// Region of objects that are built together and die together. Every handle returned by
+// `Make` shares the group's single control block via the aliasing constructor.
+//
+// Links between members of one group should be plain pointers: a `SharedPtr` stored inside
+// the group points back at its own block and keeps the whole group alive forever.
+class SharedGroup {
+public:
+    explicit SharedGroup(size_t chunk_size = 4096) {
+        auto block = new BlockGroup(chunk_size);
+        root_.block_ = block;
+        root_.ptr_ = &block->arena_;
+    }
+    SharedGroup(const SharedGroup&) = delete;
+    SharedGroup& operator=(const SharedGroup&) = delete;
+
+    template <typename T, typename... Args>
+    SharedPtr<T> Make(Args&&... args) {
+        auto block = static_cast<BlockGroup*>(root_.block_);
+        T* object = block->Create<T>(std::forward<Args>(args)...);
+        SharedPtr<T> res(root_, object);
+        res.EnableThis(object);
+        return res;
+    }
+
+    // Handles alive in addition to the group itself
+    size_t UseCount() const {
+        return root_.UseCount() - 1;
+    }
+    size_t BytesUsed() const {
+        return root_->BytesUsed();
+    }
+
+private:
+    SharedPtr<Arena> root_;
+};
@@ -0,0 +1,146 @@
+#include "../shared.h"
+#include "../shared_group.h"
+#include "../weak.h"
+#include "../my_int.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct TreeNode {
+    TreeNode(std::string name, TreeNode* parent) : name(std::move(name)), parent(parent) {
+    }
+
+    std::string name;
+    TreeNode* parent;
+    std::vector<TreeNode*> children;
+};
+
+struct Self : EnableSharedFromThis<Self> {};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Arena") {
+    Arena arena(64);
+    auto a = arena.Create<int>(1);
+    auto b = static_cast<char*>(arena.Allocate(1000, 64));
+    auto c = arena.Create<double>(2.0);
+
+    REQUIRE(*a == 1);
+    REQUIRE(*c == 2.0);
+    REQUIRE(reinterpret_cast<uintptr_t>(b) % 64 == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(c) % alignof(double) == 0);
+    REQUIRE(arena.BytesUsed() == sizeof(int) + 1000 + sizeof(double));
+
+    arena.Reset();
+    REQUIRE(arena.BytesUsed() == 0);
+    REQUIRE(*arena.Create<int>(3) == 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedGroup") {
+    SECTION("Handles share one block") {
+        SharedGroup group;
+        auto a = group.Make<MyInt>(1);
+        auto b = group.Make<MyInt>(2);
+        auto s = group.Make<std::string>("aba");
+
+        REQUIRE(a.block_ == b.block_);
+        REQUIRE(a.block_ == s.block_);
+        REQUIRE(group.UseCount() == 3);
+        REQUIRE(*b == 2);
+        REQUIRE(*s == "aba");
+        REQUIRE(MyInt::AliveCount() == 2);
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+
+    SECTION("Handles outlive the group") {
+        SharedPtr<MyInt> survivor;
+        WeakPtr<MyInt> weak;
+        {
+            SharedGroup group;
+            survivor = group.Make<MyInt>(1);
+            weak = group.Make<MyInt>(2);
+            REQUIRE(!weak.Expired());
+        }
+        REQUIRE(MyInt::AliveCount() == 2);
+        REQUIRE(!weak.Expired());
+
+        survivor.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Tree with raw internal links") {
+        SharedPtr<TreeNode> leaf;
+        {
+            SharedGroup group;
+            auto root = group.Make<TreeNode>("root", nullptr);
+            for (int i = 0; i < 100; ++i) {
+                auto child = group.Make<TreeNode>(std::to_string(i), root.Get());
+                root->children.push_back(child.Get());
+                leaf = child;
+            }
+        }
+        REQUIRE(leaf->name == "99");
+        REQUIRE(leaf->parent->name == "root");
+        REQUIRE(leaf->parent->children.size() == 100);
+    }
+
+    SECTION("Shared from this") {
+        SharedGroup group;
+        auto self = group.Make<Self>();
+        REQUIRE(self->SharedFromThis().Get() == self.Get());
+    }
+
+    SECTION("Failed constructor leaves no finalizer") {
+        struct Throwing {
+            Throwing() {
+                throw std::runtime_error("ctor");
+            }
+            ~Throwing() {
+                FAIL("never constructed");
+            }
+        };
+        {
+            SharedGroup group;
+            auto a = group.Make<MyInt>(1);
+            REQUIRE_THROWS_AS(group.Make<Throwing>(), std::runtime_error);
+            auto b = group.Make<MyInt>(2);
+            REQUIRE(MyInt::AliveCount() == 2);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedGroup vs MakeShared", "[.bench]") {
+    constexpr int kNodes = 1 << 20;
+
+    ReportBench("MakeShared tree", MeasureSeconds([] {
+                    std::vector<SharedPtr<TreeNode>> nodes;
+                    nodes.push_back(MakeShared<TreeNode>("root", nullptr));
+                    for (int i = 1; i < kNodes; ++i) {
+                        nodes.push_back(MakeShared<TreeNode>("", nodes[i / 2].Get()));
+                    }
+                }));
+    ReportBench("SharedGroup tree", MeasureSeconds([] {
+                    SharedGroup group(1 << 20);
+                    auto root = group.Make<TreeNode>("root", nullptr);
+                    std::vector<TreeNode*> nodes = {root.Get()};
+                    for (int i = 1; i < kNodes; ++i) {
+                        nodes.push_back(group.Make<TreeNode>("", nodes[i / 2]).Get());
+                    }
+                }));
+}
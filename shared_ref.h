@@ -0,0 +1,126 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>  // std::nullptr_t
+
+// Non-owning view of a `SharedPtr`: holds the same `block_` and `ptr_` but does not touch
+// `strong_`. Meant for function parameters, where the caller's `SharedPtr` outlives the call.
+// Use `ToShared()` to get a real owner when the callee needs to keep the object.
+//
+// With `SHARED_REF_CHECKS` defined (program-wide, as it changes `BlockBase`) every view is
+// counted in `BlockBase::borrowed_`, and releasing the last strong reference while a view is
+// still alive fails an assertion.
+template <typename T>
+class SharedRef {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SharedRef() {
+    }
+    SharedRef(std::nullptr_t) {
+    }
+
+    template <typename R>
+    SharedRef(const SharedPtr<R>& owner) : block_(owner.block_), ptr_(owner.ptr_) {
+        Borrow();
+    }
+
+    SharedRef(const SharedRef& other) : block_(other.block_), ptr_(other.ptr_) {
+        Borrow();
+    }
+    template <typename R>
+    SharedRef(const SharedRef<R>& other) : block_(other.block_), ptr_(other.ptr_) {
+        Borrow();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    SharedRef& operator=(const SharedRef& other) {
+        if (this == &other) {
+            return *this;
+        }
+
+        Reset();
+
+        block_ = other.block_;
+        ptr_ = other.ptr_;
+        Borrow();
+
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~SharedRef() {
+        Reset();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+#ifdef SHARED_REF_CHECKS
+        if (block_) {
+            block_->borrowed_--;
+        }
+#endif
+        block_ = nullptr;
+        ptr_ = nullptr;
+    }
+
+    // Promote to an owning pointer: the only place where the view touches `strong_`
+    SharedPtr<T> ToShared() const {
+        SharedPtr<T> res;
+        if (block_) {
+            block_->strong_++;
+        }
+        res.block_ = block_;
+        res.ptr_ = ptr_;
+        return res;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return ptr_;
+    }
+    T& operator*() const {
+        return *ptr_;
+    }
+    T* operator->() const {
+        return ptr_;
+    }
+    size_t UseCount() const {
+        if (block_) {
+            return block_->strong_;
+        }
+        return 0;
+    }
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+private:
+    void Borrow() {
+#ifdef SHARED_REF_CHECKS
+        if (block_) {
+            block_->borrowed_++;
+        }
+#endif
+    }
+
+public:
+    // Fields
+    BlockBase* block_ = nullptr;
+    T* ptr_ = nullptr;
+};
+
+template <typename T, typename U>
+inline bool operator==(const SharedRef<T>& left, const SharedRef<U>& right) {
+    return left.ptr_ == right.ptr_;
+}
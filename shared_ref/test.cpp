@@ -0,0 +1,102 @@
+#include "../shared.h"
+#include "../shared_ref.h"
+
+#include <catch.hpp>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+size_t Length(SharedRef<std::string> str) {
+    return str->size();
+}
+
+SharedPtr<std::string> Keep(SharedRef<std::string> str) {
+    return str.ToShared();
+}
+
+struct Base {
+    virtual ~Base() = default;
+    int value = 1;
+};
+
+struct Derived : Base {};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Empty SharedRef") {
+    SharedRef<int> a;
+    SharedRef<int> b(nullptr);
+    SharedRef<int> c(SharedPtr<int>{});
+
+    REQUIRE(a.Get() == nullptr);
+    REQUIRE(!b);
+    REQUIRE(c.UseCount() == 0);
+    REQUIRE(a.ToShared().Get() == nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedRef does not own") {
+    auto owner = MakeShared<std::string>("aba");
+
+    SECTION("Construction and copies") {
+        SharedRef<std::string> a(owner);
+        SharedRef<std::string> b(a);
+        SharedRef<std::string> c;
+        c = b;
+
+        REQUIRE(owner.UseCount() == 1);
+        REQUIRE(a.UseCount() == 1);
+        REQUIRE(*c == "aba");
+        REQUIRE(c.Get() == owner.Get());
+        REQUIRE(a == c);
+    }
+
+    SECTION("Parameter passing") {
+        REQUIRE(Length(owner) == 3);
+        REQUIRE(Length(MakeShared<std::string>("caba")) == 4);
+        REQUIRE(owner.UseCount() == 1);
+    }
+
+    SECTION("ToShared") {
+        auto kept = Keep(owner);
+        REQUIRE(owner.UseCount() == 2);
+        owner.Reset();
+        REQUIRE(kept.UseCount() == 1);
+        REQUIRE(*kept == "aba");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SharedRef conversions") {
+    SharedPtr<Derived> owner(new Derived);
+    SharedRef<Base> base(owner);
+    SharedRef<const Base> const_base(base);
+
+    REQUIRE(const_base->value == 1);
+    SharedPtr<Base> shared = base.ToShared();
+    REQUIRE(shared.Get() == owner.Get());
+    REQUIRE(owner.UseCount() == 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef SHARED_REF_CHECKS
+TEST_CASE("Borrow tracking") {
+    auto owner = MakeShared<int>(42);
+    {
+        SharedRef<int> a(owner);
+        SharedRef<int> b(a);
+        REQUIRE(owner.block_->borrowed_ == 2);
+        b.Reset();
+        REQUIRE(owner.block_->borrowed_ == 1);
+    }
+    REQUIRE(owner.block_->borrowed_ == 0);
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+struct SlabHeader {
+    size_t live = 0;
+};
+
+// `BlockObject` living inside a slab shared with its neighbours. The slab is freed together
+// with the last of its blocks.
+template <typename T>
+class BlockSlab : public BlockObject<T> {
+public:
+    static constexpr std::align_val_t kAlignment{alignof(BlockObject<T>) > alignof(SlabHeader)
+                                                     ? alignof(BlockObject<T>)
+                                                     : alignof(SlabHeader)};
+    static constexpr size_t kOffset =
+        (sizeof(SlabHeader) + static_cast<size_t>(kAlignment) - 1) /
+        static_cast<size_t>(kAlignment) * static_cast<size_t>(kAlignment);
+
+    template <class... Args>
+    BlockSlab(SlabHeader* slab, Args&&... args)
+        : BlockObject<T>(std::forward<Args>(args)...), slab_(slab) {
+    }
+
+    void Deallocate() override {
+        SlabHeader* slab = slab_;
+        this->~BlockSlab();
+        if (--slab->live == 0) {
+            Free(slab);
+        }
+    }
+
+    static SlabHeader* Allocate(size_t n) {
+        void* memory = ::operator new(kOffset + n * sizeof(BlockSlab), kAlignment);
+        return new (memory) SlabHeader();
+    }
+    static void Free(SlabHeader* slab) {
+        slab->~SlabHeader();
+        ::operator delete(slab, kAlignment);
+    }
+    static BlockSlab* At(SlabHeader* slab, size_t i) {
+        return reinterpret_cast<BlockSlab*>(reinterpret_cast<char*>(slab) + kOffset) + i;
+    }
+
+    SlabHeader* slab_;
+};
+
+// Like `MakeShared`, but places all `n` control blocks and objects in one contiguous slab.
+// Every element keeps its own counters and can outlive the others.
+template <typename T, typename... Args>
+std::vector<SharedPtr<T>> MakeSharedN(size_t n, const Args&... args) {
+    std::vector<SharedPtr<T>> res;
+    if (n == 0) {
+        return res;
+    }
+    res.reserve(n);
+
+    SlabHeader* slab = BlockSlab<T>::Allocate(n);
+    size_t constructed = 0;
+    try {
+        for (; constructed < n; ++constructed) {
+            new (BlockSlab<T>::At(slab, constructed)) BlockSlab<T>(slab, args...);
+        }
+    } catch (...) {
+        for (size_t i = 0; i < constructed; ++i) {
+            auto block = BlockSlab<T>::At(slab, i);
+            block->Destruct();
+            block->~BlockSlab();
+        }
+        BlockSlab<T>::Free(slab);
+        throw;
+    }
+
+    slab->live = n;
+    for (size_t i = 0; i < n; ++i) {
+        auto block = BlockSlab<T>::At(slab, i);
+        SharedPtr<T> ptr;
+        ptr.block_ = block;
+        ptr.ptr_ = block->GetPtr();
+        ptr.EnableThis(ptr.ptr_);
+        res.push_back(std::move(ptr));
+    }
+    return res;
+}
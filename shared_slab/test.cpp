@@ -0,0 +1,123 @@
+#include "../shared.h"
+#include "../shared_slab.h"
+#include "../weak.h"
+#include "../my_int.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct ThrowingCtor {
+    ThrowingCtor() {
+        if (++created == 4) {
+            throw std::runtime_error("ctor");
+        }
+        ++alive;
+    }
+    ~ThrowingCtor() {
+        --alive;
+    }
+
+    inline static int created = 0;
+    inline static int alive = 0;
+};
+
+struct Node : EnableSharedFromThis<Node> {
+    int value = 0;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeSharedN") {
+    SECTION("Contiguous and independent") {
+        auto ptrs = MakeSharedN<MyInt>(10, 5);
+        REQUIRE(ptrs.size() == 10);
+        REQUIRE(MyInt::AliveCount() == 10);
+
+        for (size_t i = 0; i < ptrs.size(); ++i) {
+            REQUIRE(*ptrs[i] == 5);
+            REQUIRE(ptrs[i].UseCount() == 1);
+            if (i > 0) {
+                auto step = reinterpret_cast<char*>(ptrs[i].block_) -
+                            reinterpret_cast<char*>(ptrs[i - 1].block_);
+                REQUIRE(step == sizeof(BlockSlab<MyInt>));
+            }
+        }
+
+        auto copy = ptrs[3];
+        ptrs[3].Reset();
+        REQUIRE(copy.UseCount() == 1);
+        REQUIRE(MyInt::AliveCount() == 10);
+
+        ptrs.clear();
+        REQUIRE(MyInt::AliveCount() == 1);
+        copy.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Weak references keep the slab") {
+        WeakPtr<std::string> weak;
+        {
+            auto ptrs = MakeSharedN<std::string>(3, "aba");
+            weak = ptrs[1];
+        }
+        REQUIRE(weak.Expired());
+        REQUIRE(weak.Lock().Get() == nullptr);
+    }
+
+    SECTION("Empty") {
+        REQUIRE(MakeSharedN<int>(0).empty());
+    }
+
+    SECTION("Shared from this") {
+        auto nodes = MakeSharedN<Node>(4);
+        auto self = nodes[2]->SharedFromThis();
+        REQUIRE(self.Get() == nodes[2].Get());
+        REQUIRE(nodes[2].UseCount() == 2);
+    }
+
+    SECTION("Throwing constructor") {
+        REQUIRE_THROWS_AS(MakeSharedN<ThrowingCtor>(10), std::runtime_error);
+        REQUIRE(ThrowingCtor::alive == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeSharedN vs MakeShared", "[.bench]") {
+    constexpr size_t kCount = 1 << 20;
+
+    // Interleave unrelated allocations, as a real program would, to scatter separate blocks
+    std::vector<SharedPtr<int>> separate;
+    std::vector<std::string> noise;
+    ReportBench("MakeShared x N", MeasureSeconds([&] {
+                    for (size_t i = 0; i < kCount; ++i) {
+                        separate.push_back(MakeShared<int>(i));
+                        noise.emplace_back(40, 'x');
+                    }
+                }));
+    std::vector<SharedPtr<int>> slab;
+    ReportBench("MakeSharedN", MeasureSeconds([&] { slab = MakeSharedN<int>(kCount, 1); }));
+
+    int64_t sum = 0;
+    ReportBench("iterate MakeShared x N", MeasureSeconds([&] {
+                    for (const auto& ptr : separate) {
+                        sum += *ptr;
+                    }
+                }));
+    ReportBench("iterate MakeSharedN", MeasureSeconds([&] {
+                    for (const auto& ptr : slab) {
+                        sum += *ptr;
+                    }
+                }));
+    DoNotOptimize(sum);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "shared.h"
+#include "weak.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+template <typename T>
+class SoftPtr;
+
+// Byte-budgeted set of extra strong references. Objects added to the cache stay alive after
+// their last ordinary owner is gone, until the bytes held exceed the budget: then the cache
+// drops its references in approximate LRU order, using the CLOCK algorithm with one
+// "referenced" bit per entry. New entries start unreferenced, so a scan over cold objects
+// does not push out the ones that are being `Lock()`-ed.
+//
+// The cache must outlive the `SoftPtr`-s it hands out.
+class SoftCache {
+public:
+    explicit SoftCache(size_t budget) : budget_(budget) {
+    }
+    SoftCache(const SoftCache&) = delete;
+    SoftCache& operator=(const SoftCache&) = delete;
+
+    ~SoftCache() {
+        for (auto& entry : entries_) {
+            if (entry.block) {
+                entry.block->ReleaseStrong();
+            }
+        }
+    }
+
+    // Hold `ptr` softly, accounting `bytes` against the budget. An object bigger than the whole
+    // budget is refused: the result only refers to it weakly, and nothing is evicted for it.
+    // Adding an object that is already held updates its size and marks it as recently used.
+    template <typename T>
+    SoftPtr<T> Add(const SharedPtr<T>& ptr, size_t bytes);
+
+    // Mark an entry as recently used; stale handles are ignored
+    void Touch(size_t slot, uint32_t generation) {
+        if (slot < entries_.size() && entries_[slot].generation == generation) {
+            entries_[slot].referenced = true;
+        }
+    }
+
+    size_t BytesHeld() const {
+        return held_;
+    }
+    size_t Budget() const {
+        return budget_;
+    }
+    // Objects currently held
+    size_t Size() const {
+        return entries_.size() - free_.size();
+    }
+
+private:
+    struct Entry {
+        BlockBase* block = nullptr;
+        size_t bytes = 0;
+        uint32_t generation = 0;
+        bool referenced = false;
+    };
+
+    // Slot of `block`, or `SIZE_MAX` if it is not held
+    size_t Find(BlockBase* block) const {
+        auto it = slots_.find(block);
+        return it == slots_.end() ? SIZE_MAX : it->second;
+    }
+
+    size_t Hold(BlockBase* block, size_t bytes) {
+        size_t slot;
+        if (!free_.empty()) {
+            slot = free_.back();
+            free_.pop_back();
+        } else {
+            slot = entries_.size();
+            entries_.emplace_back();
+        }
+        slots_[block] = slot;
+        block->strong_++;
+        entries_[slot].block = block;
+        entries_[slot].bytes = bytes;
+        entries_[slot].referenced = false;
+        held_ += bytes;
+        return slot;
+    }
+
+    // Evict entries other than `keep` until the budget is met. `keep` fits the budget on its
+    // own, so at most two sweeps of the hand get there.
+    void Shrink(size_t keep) {
+        while (held_ > budget_ && Size() > 1) {
+            size_t slot = hand_;
+            hand_ = (hand_ + 1) % entries_.size();
+            Entry& entry = entries_[slot];
+            if (!entry.block || slot == keep) {
+                continue;
+            }
+            if (entry.referenced) {
+                entry.referenced = false;
+                continue;
+            }
+            Evict(slot);
+        }
+    }
+
+    void Evict(size_t slot) {
+        Entry& entry = entries_[slot];
+        held_ -= entry.bytes;
+        BlockBase* block = entry.block;
+        entry.block = nullptr;
+        entry.generation++;
+        free_.push_back(slot);
+        slots_.erase(block);
+        block->ReleaseStrong();
+    }
+
+    std::vector<Entry> entries_;
+    std::unordered_map<const BlockBase*, size_t> slots_;
+    std::vector<size_t> free_;
+    size_t hand_ = 0;
+    size_t held_ = 0;
+    size_t budget_;
+};
+
+// Weak reference that the owning `SoftCache` also keeps strongly for a while. `Lock()` marks
+// the entry as recently used.
+template <typename T>
+class SoftPtr {
+public:
+    SoftPtr() {
+    }
+    SoftPtr(const SharedPtr<T>& ptr, SoftCache* cache, size_t slot, uint32_t generation)
+        : weak_(ptr), cache_(cache), slot_(slot), generation_(generation) {
+    }
+
+    SharedPtr<T> Lock() const {
+        auto res = weak_.Lock();
+        if (res && cache_) {
+            cache_->Touch(slot_, generation_);
+        }
+        return res;
+    }
+    bool Expired() const {
+        return weak_.Expired();
+    }
+
+private:
+    WeakPtr<T> weak_;
+    SoftCache* cache_ = nullptr;
+    size_t slot_ = 0;
+    uint32_t generation_ = 0;
+};
+
+template <typename T>
+SoftPtr<T> SoftCache::Add(const SharedPtr<T>& ptr, size_t bytes) {
+    if (!ptr.block_) {
+        return SoftPtr<T>();
+    }
+    size_t slot = Find(ptr.block_);
+    if (bytes > budget_) {
+        if (slot != SIZE_MAX) {
+            Evict(slot);
+        }
+        return SoftPtr<T>(ptr, nullptr, 0, 0);
+    }
+    if (slot != SIZE_MAX) {
+        Entry& entry = entries_[slot];
+        held_ = held_ - entry.bytes + bytes;
+        entry.bytes = bytes;
+        entry.referenced = true;
+    } else {
+        slot = Hold(ptr.block_, bytes);
+    }
+    SoftPtr<T> res(ptr, this, slot, entries_[slot].generation);
+    Shrink(slot);
+    return res;
+}
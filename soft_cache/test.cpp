@@ -0,0 +1,179 @@
+#include "../shared.h"
+#include "../soft_cache.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Page {
+    static inline int alive = 0;
+
+    explicit Page(int id) : id(id) {
+        ++alive;
+    }
+    ~Page() {
+        --alive;
+    }
+
+    int id;
+    char data[1000] = {};
+};
+
+}  // namespace
+
+TEST_CASE("SoftCache") {
+    SECTION("Keeps objects alive without other owners") {
+        SoftCache cache(10 * sizeof(Page));
+        auto soft = cache.Add(MakeShared<Page>(1), sizeof(Page));
+
+        REQUIRE(!soft.Expired());
+        auto page = soft.Lock();
+        REQUIRE(page->id == 1);
+        REQUIRE(page.UseCount() == 2);
+        REQUIRE(cache.Size() == 1);
+        REQUIRE(cache.BytesHeld() == sizeof(Page));
+    }
+
+    SECTION("Memory stays within the budget") {
+        Page::alive = 0;
+        {
+            SoftCache cache(10 * sizeof(Page));
+            std::vector<SoftPtr<Page>> softs;
+            for (int i = 0; i < 100; ++i) {
+                softs.push_back(cache.Add(MakeShared<Page>(i), sizeof(Page)));
+                REQUIRE(cache.BytesHeld() <= cache.Budget());
+                REQUIRE(Page::alive <= 10);
+            }
+            REQUIRE(cache.Size() == 10);
+
+            int expired = 0;
+            for (auto& soft : softs) {
+                expired += soft.Expired();
+            }
+            REQUIRE(expired == 90);
+        }
+        REQUIRE(Page::alive == 0);
+    }
+
+    SECTION("Strong owners outlive eviction") {
+        SoftCache cache(sizeof(Page));
+        auto first = MakeShared<Page>(1);
+        auto soft = cache.Add(first, sizeof(Page));
+        cache.Add(MakeShared<Page>(2), sizeof(Page));
+
+        REQUIRE(first.UseCount() == 1);
+        REQUIRE(soft.Lock()->id == 1);
+    }
+
+    SECTION("Recently used entries survive") {
+        SoftCache cache(4 * sizeof(Page));
+        std::vector<SoftPtr<Page>> softs;
+        for (int i = 0; i < 4; ++i) {
+            softs.push_back(cache.Add(MakeShared<Page>(i), sizeof(Page)));
+        }
+        // Nothing was locked yet, so the oldest entry goes first
+        softs.push_back(cache.Add(MakeShared<Page>(4), sizeof(Page)));
+        REQUIRE(softs[0].Expired());
+
+        for (int i = 5; i < 20; ++i) {
+            REQUIRE(softs[2].Lock());
+            softs.push_back(cache.Add(MakeShared<Page>(i), sizeof(Page)));
+        }
+        REQUIRE(!softs[2].Expired());
+        REQUIRE(cache.Size() == 4);
+    }
+
+    SECTION("Refuses objects over the budget") {
+        SoftCache cache(100);
+        auto small = cache.Add(MakeShared<int>(1), 50);
+        auto big = MakeShared<int>(2);
+        auto soft = cache.Add(big, 1000);
+
+        REQUIRE(cache.Size() == 1);
+        REQUIRE(cache.BytesHeld() == 50);
+        REQUIRE(!small.Expired());
+        REQUIRE(*soft.Lock() == 2);
+        REQUIRE(big.UseCount() == 1);
+        big.Reset();
+        REQUIRE(soft.Expired());
+
+        SoftCache tiny(100);
+        auto dropped = tiny.Add(MakeShared<int>(3), 1000);
+        REQUIRE(dropped.Expired());
+        REQUIRE(tiny.Size() == 0);
+    }
+
+    SECTION("Adding the same object twice updates it") {
+        SoftCache cache(100);
+        auto ptr = MakeShared<int>(1);
+        auto first = cache.Add(ptr, 30);
+        auto second = cache.Add(ptr, 40);
+        REQUIRE(cache.Size() == 1);
+        REQUIRE(cache.BytesHeld() == 40);
+        REQUIRE(ptr.UseCount() == 2);
+
+        // Growing past the budget drops the cache's reference once
+        auto third = cache.Add(ptr, 1000);
+        REQUIRE(cache.Size() == 0);
+        REQUIRE(cache.BytesHeld() == 0);
+        REQUIRE(ptr.UseCount() == 1);
+        ptr.Reset();
+        REQUIRE(first.Expired());
+        REQUIRE(third.Expired());
+    }
+
+    SECTION("Hit rate") {
+        SoftCache cache(64 * sizeof(Page));
+        std::vector<SoftPtr<Page>> softs(256);
+        int hits = 0;
+        int misses = 0;
+        uint32_t state = 1;
+        for (int i = 0; i < 20000; ++i) {
+            state = state * 1664525 + 1013904223;
+            // 90% of requests go to a hot set of 32 pages
+            int id = (state >> 8) % 10 ? (state >> 16) % 32 : (state >> 16) % 256;
+            if (auto page = softs[id].Lock()) {
+                REQUIRE(page->id == id);
+                ++hits;
+            } else {
+                softs[id] = cache.Add(MakeShared<Page>(id), sizeof(Page));
+                ++misses;
+            }
+        }
+        REQUIRE(hits > 8 * misses);
+        REQUIRE(cache.BytesHeld() <= cache.Budget());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("SoftCache bench", "[.bench]") {
+    constexpr int kKeys = 1 << 12;
+    constexpr int kLookups = 1 << 20;
+
+    SoftCache cache(kKeys / 4 * sizeof(Page));
+    std::vector<SoftPtr<Page>> softs(kKeys);
+    int hits = 0;
+    uint32_t state = 1;
+    double seconds = MeasureSeconds([&] {
+        for (int i = 0; i < kLookups; ++i) {
+            state = state * 1664525 + 1013904223;
+            int id = (state >> 8) % 10 ? (state >> 12) % (kKeys / 8) : (state >> 12) % kKeys;
+            if (auto page = softs[id].Lock()) {
+                DoNotOptimize(page->id);
+                ++hits;
+            } else {
+                softs[id] = cache.Add(MakeShared<Page>(id), sizeof(Page));
+            }
+        }
+    });
+    ReportBench("SoftPtr::Lock with SoftCache", seconds);
+    std::cout << "hit rate: " << 100.0 * hits / kLookups << "%" << std::endl;
+}
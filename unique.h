@@ -2,11 +2,31 @@
 
 #include "compressed_pair.h"
 
+#include <concepts>
 #include <cstddef>  // std::nullptr_t
 #include <memory>
 #include <type_traits>
 #include <utility>
 
+// Handle type stored by `UniquePtr`: `Deleter::pointer` if the deleter defines one, `T*` otherwise
+template <typename T, typename Deleter, typename = void>
+struct UniquePointerType {
+    using Type = T*;
+};
+
+template <typename T, typename Deleter>
+struct UniquePointerType<T, Deleter,
+                         std::void_t<typename std::remove_reference_t<Deleter>::pointer>> {
+    using Type = typename std::remove_reference_t<Deleter>::pointer;
+};
+
+// What `UniquePtr` needs from a handle: a value-initialized handle is the null one, and
+// handles can be copied and compared. Raw pointers, fancy pointers and wrapped integers like
+// `FdHandle` from handles.h all qualify.
+template <typename P>
+concept NullableHandle = std::is_default_constructible_v<P> && std::is_copy_assignable_v<P> &&
+                         std::equality_comparable<P>;
+
 struct Slug {
     template <typename T>
     void operator()(T* obj) {
@@ -21,10 +41,15 @@ struct Slug {
 template <typename T, typename Deleter = std::default_delete<T>>
 class UniquePtr {
 public:
+    using Pointer = typename UniquePointerType<T, Deleter>::Type;
+    static_assert(NullableHandle<Pointer>);
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
     UniquePtr() {
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
+    }
+    explicit UniquePtr(Pointer ptr) : pair_(ptr, Deleter()) {
     }
     template <typename R>
     explicit UniquePtr(R* ptr) : pair_(ptr, Deleter()) {
@@ -36,16 +61,22 @@ public:
     UniquePtr(R* ptr, const Del2& deleter) : pair_(ptr, deleter) {
     }
     template <typename Del2>
-    UniquePtr(std::nullptr_t ptr, const Del2& deleter) : pair_(ptr, deleter) {
+    UniquePtr(Pointer ptr, Del2&& deleter) : pair_(ptr, std::forward<Del2>(deleter)) {
+    }
+    template <typename Del2>
+    UniquePtr(Pointer ptr, const Del2& deleter) : pair_(ptr, deleter) {
+    }
+    template <typename Del2>
+    UniquePtr(std::nullptr_t, const Del2& deleter) : pair_(Pointer(), deleter) {
     }
     template <typename Del2>
-    UniquePtr(std::nullptr_t ptr, Del2&& deleter) : pair_(ptr, std::forward<Del2>(deleter)) {
+    UniquePtr(std::nullptr_t, Del2&& deleter) : pair_(Pointer(), std::forward<Del2>(deleter)) {
     }
 
     template <typename R, typename Del2>
     UniquePtr(UniquePtr<R, Del2>&& other) noexcept
         : pair_(other.pair_.GetFirst(), std::forward<Del2>(other.pair_.GetSecond())) {
-        other.pair_.GetFirst() = nullptr;
+        other.pair_.GetFirst() = {};
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,20 +87,20 @@ public:
             return *this;
         }
 
-        if (pair_.GetFirst() != nullptr) {
+        if (pair_.GetFirst() != Pointer()) {
             pair_.GetSecond()(pair_.GetFirst());
-            pair_.GetFirst() = nullptr;
+            pair_.GetFirst() = Pointer();
         }
 
         pair_ = std::forward<decltype(other.pair_)>(other.pair_);
-        other.pair_.GetFirst() = nullptr;
+        other.pair_.GetFirst() = {};
         return *this;
     }
     UniquePtr& operator=(std::nullptr_t) {
-        if (pair_.GetFirst() != nullptr) {
+        if (pair_.GetFirst() != Pointer()) {
             pair_.GetSecond()(pair_.GetFirst());
         }
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
         return *this;
     }
     UniquePtr(UniquePtr&) = delete;
@@ -78,33 +109,33 @@ public:
     // Destructor
 
     ~UniquePtr() {
-        if (pair_.GetFirst() != nullptr) {
+        if (pair_.GetFirst() != Pointer()) {
             pair_.GetSecond()(pair_.GetFirst());
         }
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    T* Release() {
+    Pointer Release() {
         auto res = pair_.GetFirst();
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
         return res;
     }
-    void Reset(T* ptr = nullptr) {
+    void Reset(Pointer ptr = Pointer()) {
         if (pair_.GetFirst() == ptr) {
             return;
         }
         auto tmp = pair_.GetFirst();
         pair_.GetFirst() = ptr;
-        if (tmp != nullptr) {
+        if (tmp != Pointer()) {
             pair_.GetSecond()(tmp);
         }
     }
     template <typename R, typename Del2>
     void Swap(UniquePtr<R, Del2>& other) {
-        CompressedPair<T*, Deleter> tmp = std::move(pair_);
+        CompressedPair<Pointer, Deleter> tmp = std::move(pair_);
         pair_ = std::move(other.pair_);
         other.pair_ = std::move(tmp);
 
@@ -116,7 +147,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const {
+    Pointer Get() const {
         return pair_.GetFirst();
     }
     Deleter& GetDeleter() {
@@ -126,7 +157,7 @@ public:
         return pair_.GetSecond();
     }
     explicit operator bool() const {
-        return pair_.GetFirst() != nullptr;
+        return pair_.GetFirst() != Pointer();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -135,22 +166,27 @@ public:
     typename std::add_lvalue_reference<T>::type operator*() const {
         return *pair_.GetFirst();
     }
-    T* operator->() const {
+    Pointer operator->() const {
         return pair_.GetFirst();
     }
 
 public:
-    CompressedPair<T*, Deleter> pair_;
+    CompressedPair<Pointer, Deleter> pair_;
 };
 
 // Specialization for arrays
 template <typename T, typename Deleter>
 class UniquePtr<T[], Deleter> {
 public:
+    using Pointer = typename UniquePointerType<T, Deleter>::Type;
+    static_assert(NullableHandle<Pointer>);
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
     UniquePtr() {
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
+    }
+    explicit UniquePtr(Pointer ptr) : pair_(ptr, Deleter()) {
     }
     template <typename R>
     explicit UniquePtr(R* ptr) : pair_(ptr, Deleter()) {
@@ -161,18 +197,24 @@ public:
     template <typename R, typename Del2>
     UniquePtr(R* ptr, const Del2& deleter) : pair_(ptr, deleter) {
     }
+    template <typename Del2>
+    UniquePtr(Pointer ptr, Del2&& deleter) : pair_(ptr, std::forward<Del2>(deleter)) {
+    }
+    template <typename Del2>
+    UniquePtr(Pointer ptr, const Del2& deleter) : pair_(ptr, deleter) {
+    }
 
     template <typename Del2>
-    UniquePtr(std::nullptr_t ptr, const Del2& deleter) : pair_(ptr, deleter) {
+    UniquePtr(std::nullptr_t, const Del2& deleter) : pair_(Pointer(), deleter) {
     }
     template <typename Del2>
-    UniquePtr(std::nullptr_t ptr, Del2&& deleter) : pair_(ptr, std::forward<Del2>(deleter)) {
+    UniquePtr(std::nullptr_t, Del2&& deleter) : pair_(Pointer(), std::forward<Del2>(deleter)) {
     }
 
     template <typename R, typename Del2>
     UniquePtr(UniquePtr<R, Del2>&& other) noexcept
         : pair_(other.pair_.GetFirst(), std::forward<Del2>(other.pair_.GetSecond())) {
-        other.pair_.GetFirst() = nullptr;
+        other.pair_.GetFirst() = {};
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -183,20 +225,20 @@ public:
             return *this;
         }
 
-        if (pair_.GetFirst() != nullptr) {
+        if (pair_.GetFirst() != Pointer()) {
             pair_.GetSecond()(pair_.GetFirst());
-            pair_.GetFirst() = nullptr;
+            pair_.GetFirst() = Pointer();
         }
 
         pair_ = std::forward<decltype(other.pair_)>(other.pair_);
-        other.pair_.GetFirst() = nullptr;
+        other.pair_.GetFirst() = {};
         return *this;
     }
     UniquePtr& operator=(std::nullptr_t) {
-        if (pair_.GetFirst() != nullptr) {
+        if (pair_.GetFirst() != Pointer()) {
             pair_.GetSecond()(pair_.GetFirst());
         }
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
         return *this;
     }
     UniquePtr(UniquePtr&) = delete;
@@ -205,33 +247,33 @@ public:
     // Destructor
 
     ~UniquePtr() {
-        if (pair_.GetFirst() != nullptr) {
+        if (pair_.GetFirst() != Pointer()) {
             pair_.GetSecond()(pair_.GetFirst());
         }
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    T* Release() {
+    Pointer Release() {
         auto res = pair_.GetFirst();
-        pair_.GetFirst() = nullptr;
+        pair_.GetFirst() = Pointer();
         return res;
     }
-    void Reset(T* ptr = nullptr) {
+    void Reset(Pointer ptr = Pointer()) {
         if (pair_.GetFirst() == ptr) {
             return;
         }
         auto tmp = pair_.GetFirst();
         pair_.GetFirst() = ptr;
-        if (tmp != nullptr) {
+        if (tmp != Pointer()) {
             pair_.GetSecond()(tmp);
         }
     }
     template <typename R, typename Del2>
     void Swap(UniquePtr<R, Del2>& other) {
-        CompressedPair<T*, Deleter> tmp = std::move(pair_);
+        CompressedPair<Pointer, Deleter> tmp = std::move(pair_);
         pair_ = std::move(other.pair_);
         other.pair_ = std::move(tmp);
 
@@ -243,7 +285,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const {
+    Pointer Get() const {
         return pair_.GetFirst();
     }
     Deleter& GetDeleter() {
@@ -253,7 +295,7 @@ public:
         return pair_.GetSecond();
     }
     explicit operator bool() const {
-        return pair_.GetFirst() != nullptr;
+        return pair_.GetFirst() != Pointer();
     }
 
     T& operator[](int ind) const {
@@ -266,10 +308,10 @@ public:
     typename std::add_lvalue_reference<T>::type operator*() const {
         return *pair_.GetFirst();
     }
-    T* operator->() const {
+    Pointer operator->() const {
         return pair_.GetFirst();
     }
 
 public:
-    CompressedPair<T*, Deleter> pair_;
+    CompressedPair<Pointer, Deleter> pair_;
 };
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Frees arrays made by `MakeUniqueAligned`. The alignment is part of the type, so the deleter
+// stays stateless and kernels can rely on it through `GetAligned`.
+//
+// Element count is needed only to run destructors: for non-trivially destructible `T` it is
+// stored in a cookie right before the array, like `new T[]` does.
+template <typename T, size_t Alignment>
+struct AlignedDeleter;
+
+template <typename T, size_t Alignment>
+struct AlignedDeleter<T[], Alignment> {
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+    static_assert(Alignment >= alignof(T), "Alignment is weaker than alignof(T)");
+
+    static constexpr size_t kAlignment = Alignment;
+    static constexpr bool kHasCookie = !std::is_trivially_destructible_v<T>;
+    static constexpr size_t kCookieSize =
+        kHasCookie ? (sizeof(size_t) + Alignment - 1) / Alignment * Alignment : 0;
+
+    void operator()(T* ptr) const {
+        char* memory = reinterpret_cast<char*>(ptr) - kCookieSize;
+        if constexpr (kHasCookie) {
+            size_t n = *reinterpret_cast<size_t*>(memory);
+            for (size_t i = n; i > 0; --i) {
+                ptr[i - 1].~T();
+            }
+        }
+        ::operator delete[](memory, std::align_val_t{Alignment});
+    }
+};
+
+template <typename T, size_t Alignment>
+using AlignedArray = UniquePtr<T[], AlignedDeleter<T[], Alignment>>;
+
+// Value-initialized array of `n` elements starting at a multiple of `Alignment`, e.g.
+// `MakeUniqueAligned<float[], 64>(n)` for AVX-512 or `<char[], 4096>` for O_DIRECT.
+// Throws `std::bad_array_new_length` if the array does not fit in `size_t` bytes.
+template <typename Array, size_t Alignment>
+AlignedArray<std::remove_extent_t<Array>, Alignment> MakeUniqueAligned(size_t n) {
+    static_assert(std::is_unbounded_array_v<Array>, "Use MakeUniqueAligned<T[], Alignment>");
+    using T = std::remove_extent_t<Array>;
+    using Deleter = AlignedDeleter<T[], Alignment>;
+
+    if (n > (SIZE_MAX - Deleter::kCookieSize) / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+    char* memory = static_cast<char*>(
+        ::operator new[](Deleter::kCookieSize + n * sizeof(T), std::align_val_t{Alignment}));
+    T* data = reinterpret_cast<T*>(memory + Deleter::kCookieSize);
+    size_t constructed = 0;
+    try {
+        for (; constructed < n; ++constructed) {
+            new (data + constructed) T();
+        }
+    } catch (...) {
+        for (size_t i = constructed; i > 0; --i) {
+            data[i - 1].~T();
+        }
+        ::operator delete[](memory, std::align_val_t{Alignment});
+        throw;
+    }
+    if constexpr (Deleter::kHasCookie) {
+        *reinterpret_cast<size_t*>(memory) = n;
+    }
+    return AlignedArray<T, Alignment>(data);
+}
+
+// Raw pointer the compiler may assume to be `Alignment`-aligned
+template <typename T, size_t Alignment>
+T* GetAligned(const AlignedArray<T, Alignment>& array) {
+    return std::assume_aligned<Alignment>(array.Get());
+}
@@ -0,0 +1,92 @@
+#include "../unique.h"
+#include "../unique_aligned.h"
+#include "../my_int.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool IsAligned(const void* ptr, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+struct ThrowingCtor {
+    ThrowingCtor() {
+        if (++created == 3) {
+            throw std::runtime_error("ctor");
+        }
+        ++alive;
+    }
+    ~ThrowingCtor() {
+        --alive;
+    }
+
+    inline static int created = 0;
+    inline static int alive = 0;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeUniqueAligned") {
+    SECTION("Zero overhead") {
+        static_assert(sizeof(AlignedArray<float, 64>) == sizeof(float*));
+        static_assert(sizeof(AlignedArray<std::string, 4096>) == sizeof(std::string*));
+    }
+
+    SECTION("SIMD alignment") {
+        auto buffer = MakeUniqueAligned<float[], 64>(1000);
+        REQUIRE(IsAligned(buffer.Get(), 64));
+        REQUIRE(buffer[999] == 0.0f);
+
+        float* data = GetAligned(buffer);
+        for (int i = 0; i < 1000; ++i) {
+            data[i] = i;
+        }
+        REQUIRE(buffer[10] == 10.0f);
+    }
+
+    SECTION("Page alignment") {
+        auto page = MakeUniqueAligned<char[], 4096>(3 * 4096);
+        REQUIRE(IsAligned(page.Get(), 4096));
+    }
+
+    SECTION("Non-trivial elements") {
+        {
+            auto ints = MakeUniqueAligned<MyInt[], 64>(17);
+            REQUIRE(IsAligned(ints.Get(), 64));
+            REQUIRE(MyInt::AliveCount() == 17);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+
+        auto strings = MakeUniqueAligned<std::string[], 32>(3);
+        strings[2] = "aba";
+        REQUIRE(strings[2] == "aba");
+        strings.Reset();
+        REQUIRE(!strings);
+    }
+
+    SECTION("Empty") {
+        auto empty = MakeUniqueAligned<MyInt[], 64>(0);
+        REQUIRE(IsAligned(empty.Get(), 64));
+    }
+
+    SECTION("Throwing constructor") {
+        REQUIRE_THROWS_AS((MakeUniqueAligned<ThrowingCtor[], 64>(10)), std::runtime_error);
+        REQUIRE(ThrowingCtor::alive == 0);
+    }
+
+    SECTION("Oversized") {
+        REQUIRE_THROWS_AS((MakeUniqueAligned<float[], 64>(SIZE_MAX / 2)),
+                          std::bad_array_new_length);
+        REQUIRE_THROWS_AS((MakeUniqueAligned<std::string[], 64>(SIZE_MAX / sizeof(std::string))),
+                          std::bad_array_new_length);
+    }
+}
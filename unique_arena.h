@@ -0,0 +1,23 @@
+#pragma once
+
+#include "arena.h"
+#include "unique.h"
+
+#include <type_traits>
+#include <utility>
+
+// Runs the destructor only: the memory belongs to an `Arena` and goes away with its `Reset()`.
+// Stateless, so `UniquePtr<T, ArenaDeleter>` is as small as `T*`.
+struct ArenaDeleter {
+    template <typename T>
+    void operator()(T* ptr) const {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            ptr->~T();
+        }
+    }
+};
+
+template <typename T, typename... Args>
+UniquePtr<T, ArenaDeleter> MakeUniqueIn(Arena& arena, Args&&... args) {
+    return UniquePtr<T, ArenaDeleter>(arena.Create<T>(std::forward<Args>(args)...));
+}
@@ -0,0 +1,106 @@
+#include "../unique.h"
+#include "../unique_arena.h"
+#include "../my_int.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Base {
+    virtual ~Base() = default;
+};
+
+struct Derived : Base {
+    ~Derived() override {
+        ++destroyed;
+    }
+
+    inline static int destroyed = 0;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeUniqueIn") {
+    SECTION("Size") {
+        static_assert(sizeof(UniquePtr<int, ArenaDeleter>) == sizeof(int*));
+        static_assert(sizeof(UniquePtr<std::string, ArenaDeleter>) == sizeof(std::string*));
+    }
+
+    SECTION("Runs destructors") {
+        Arena arena;
+        {
+            auto a = MakeUniqueIn<MyInt>(arena, 1);
+            auto b = MakeUniqueIn<MyInt>(arena, 2);
+            REQUIRE(*b == 2);
+            REQUIRE(MyInt::AliveCount() == 2);
+            a.Reset();
+            REQUIRE(MyInt::AliveCount() == 1);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+        REQUIRE(arena.BytesUsed() == 2 * sizeof(MyInt));
+        arena.Reset();
+        REQUIRE(arena.BytesUsed() == 0);
+    }
+
+    SECTION("Moves and conversions") {
+        Arena arena;
+        UniquePtr<Base, ArenaDeleter> base;
+        {
+            auto derived = MakeUniqueIn<Derived>(arena);
+            base = std::move(derived);
+            REQUIRE(derived.Get() == nullptr);
+        }
+        REQUIRE(Derived::destroyed == 0);
+        base.Reset();
+        REQUIRE(Derived::destroyed == 1);
+    }
+
+    SECTION("Trivial types") {
+        Arena arena;
+        auto value = MakeUniqueIn<int>(arena, 42);
+        REQUIRE(*value == 42);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeUniqueIn vs new/delete", "[.bench]") {
+    constexpr int kRequests = 1 << 10;
+    constexpr int kTemporaries = 1 << 10;
+    struct Temporary {
+        int64_t values[4];
+    };
+
+    ReportBench("new/delete", MeasureSeconds([] {
+                    for (int r = 0; r < kRequests; ++r) {
+                        std::vector<UniquePtr<Temporary>> temporaries;
+                        temporaries.reserve(kTemporaries);
+                        for (int i = 0; i < kTemporaries; ++i) {
+                            temporaries.emplace_back(new Temporary());
+                        }
+                        DoNotOptimize(temporaries.back().Get());
+                    }
+                }));
+    Arena arena(1 << 16);
+    ReportBench("MakeUniqueIn + Reset", MeasureSeconds([&] {
+                    for (int r = 0; r < kRequests; ++r) {
+                        {
+                            std::vector<UniquePtr<Temporary, ArenaDeleter>> temporaries;
+                            temporaries.reserve(kTemporaries);
+                            for (int i = 0; i < kTemporaries; ++i) {
+                                temporaries.push_back(MakeUniqueIn<Temporary>(arena));
+                            }
+                            DoNotOptimize(temporaries.back().Get());
+                        }
+                        arena.Reset();
+                    }
+                }));
+}
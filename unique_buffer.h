@@ -0,0 +1,264 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+
+// Frees the raw storage of a `UniqueBuffer`: `munmap` for mapped buffers, `free` otherwise
+struct BufferDeleter {
+    template <typename T>
+    void operator()(T* ptr) const {
+        if (mapped_) {
+            munmap(ptr, mapped_);
+        } else {
+            std::free(ptr);
+        }
+    }
+
+    // Length of the mapping, 0 for `malloc`-ed storage
+    size_t mapped_ = 0;
+};
+
+// Growable array on top of `UniquePtr<T[]>` that remembers its size and capacity.
+// Trivially copyable elements are relocated by the allocator itself: `realloc` while the
+// buffer is small, `mremap` once it has moved to its own mapping, so growth rarely copies.
+template <typename T>
+class UniqueBuffer {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned T is not supported");
+
+public:
+    static constexpr bool kRelocatable = std::is_trivially_copyable_v<T>;
+    // Buffers at least this large get their own mapping
+    static constexpr size_t kMmapThreshold = 1 << 20;
+    // Largest capacity whose byte size, rounded up to whole pages, still fits in `size_t`
+    static constexpr size_t kMaxCapacity = PTRDIFF_MAX / sizeof(T);
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    UniqueBuffer() {
+    }
+    explicit UniqueBuffer(size_t size) {
+        Resize(size);
+    }
+    UniqueBuffer(UniqueBuffer&& other) noexcept
+        : data_(std::move(other.data_)), size_(other.size_), capacity_(other.capacity_) {
+        other.data_.GetDeleter().mapped_ = 0;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    UniqueBuffer& operator=(UniqueBuffer&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+
+        Clear();
+
+        data_ = std::move(other.data_);
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+
+        other.data_.GetDeleter().mapped_ = 0;
+        other.size_ = 0;
+        other.capacity_ = 0;
+
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~UniqueBuffer() {
+        Clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ == capacity_) {
+            // `args` may refer into the old storage, so the element is built before it is freed
+            size_t capacity = capacity_ ? 2 * capacity_ : 8;
+            if constexpr (kRelocatable) {
+                T value(std::forward<Args>(args)...);
+                Reserve(capacity);
+                new (data_.Get() + size_) T(value);
+            } else {
+                Relocate(capacity, [&](T* slot) {
+                    new (slot) T(std::forward<Args>(args)...);
+                    return true;
+                });
+            }
+            return data_.Get()[size_++];
+        }
+        T* res = new (data_.Get() + size_) T(std::forward<Args>(args)...);
+        size_++;
+        return *res;
+    }
+    void PushBack(const T& value) {
+        EmplaceBack(value);
+    }
+    void PushBack(T&& value) {
+        EmplaceBack(std::move(value));
+    }
+    void PopBack() {
+        data_.Get()[--size_].~T();
+    }
+
+    void Resize(size_t size) {
+        while (size_ > size) {
+            PopBack();
+        }
+        Reserve(size);
+        for (; size_ < size; ++size_) {
+            new (data_.Get() + size_) T();
+        }
+    }
+    void Clear() {
+        while (size_ > 0) {
+            PopBack();
+        }
+    }
+
+    // Throws `std::length_error` for capacities above `kMaxCapacity`
+    void Reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        CheckCapacity(capacity);
+        if constexpr (kRelocatable) {
+            size_t bytes = capacity * sizeof(T);
+            if (data_.GetDeleter().mapped_ || bytes >= kMmapThreshold) {
+                GrowMapped(bytes);
+                return;
+            }
+            void* memory = std::realloc(data_.Get(), bytes);
+            if (!memory) {
+                throw std::bad_alloc();
+            }
+            data_.Release();
+            data_.Reset(static_cast<T*>(memory));
+            capacity_ = capacity;
+        } else {
+            Relocate(capacity, [](T*) { return false; });
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Data() const {
+        return data_.Get();
+    }
+    size_t Size() const {
+        return size_;
+    }
+    size_t Capacity() const {
+        return capacity_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+    bool IsMapped() const {
+        return data_.GetDeleter().mapped_ != 0;
+    }
+    T& operator[](size_t ind) const {
+        return data_.Get()[ind];
+    }
+    std::span<T> Span() const {
+        return {data_.Get(), size_};
+    }
+    T* begin() const {
+        return data_.Get();
+    }
+    T* end() const {
+        return data_.Get() + size_;
+    }
+
+private:
+    static void CheckCapacity(size_t capacity) {
+        if (capacity > kMaxCapacity) {
+            throw std::length_error("UniqueBuffer capacity is too large");
+        }
+    }
+
+    // Move the elements to fresh `malloc`-ed storage. `build(slot)` may construct one more
+    // element right behind them (and return true) while the old storage is still alive.
+    template <typename Build>
+    void Relocate(size_t capacity, Build&& build) {
+        CheckCapacity(capacity);
+        T* memory = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+        if (!memory) {
+            throw std::bad_alloc();
+        }
+        bool built = false;
+        size_t moved = 0;
+        try {
+            built = build(memory + size_);
+            for (; moved < size_; ++moved) {
+                new (memory + moved) T(std::move_if_noexcept(data_.Get()[moved]));
+            }
+        } catch (...) {
+            for (size_t i = 0; i < moved; ++i) {
+                memory[i].~T();
+            }
+            if (built) {
+                memory[size_].~T();
+            }
+            std::free(memory);
+            throw;
+        }
+        for (size_t i = 0; i < size_; ++i) {
+            data_.Get()[i].~T();
+        }
+        data_.Reset(memory);
+        capacity_ = capacity;
+    }
+
+    void GrowMapped(size_t bytes) {
+        size_t page = 4096;
+        bytes = (bytes + page - 1) / page * page;
+        size_t& mapped = data_.GetDeleter().mapped_;
+        void* memory;
+        if (mapped) {
+            memory = mremap(data_.Get(), mapped, bytes, MREMAP_MAYMOVE);
+        } else {
+            memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1, 0);
+            if (memory != MAP_FAILED && data_) {
+                std::memcpy(memory, data_.Get(), size_ * sizeof(T));
+            }
+        }
+        if (memory == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        if (!mapped) {
+            // Moving off the heap: free the old block while the deleter still says `malloc`
+            data_.Reset();
+        } else {
+            data_.Release();
+        }
+        mapped = bytes;
+        data_.Reset(static_cast<T*>(memory));
+        capacity_ = bytes / sizeof(T);
+    }
+
+    UniquePtr<T[], BufferDeleter> data_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
@@ -0,0 +1,141 @@
+#include "../unique.h"
+#include "../unique_buffer.h"
+#include "../my_int.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("UniqueBuffer") {
+    SECTION("Appends") {
+        UniqueBuffer<int> buffer;
+        REQUIRE(buffer.Empty());
+        for (int i = 0; i < 1000; ++i) {
+            buffer.PushBack(i);
+        }
+        REQUIRE(buffer.Size() == 1000);
+        REQUIRE(buffer.Capacity() >= 1000);
+        REQUIRE(!buffer.IsMapped());
+
+        auto span = buffer.Span();
+        REQUIRE(span.size() == 1000);
+        REQUIRE(std::accumulate(span.begin(), span.end(), 0) == 999 * 1000 / 2);
+    }
+
+    SECTION("Moves to a mapping when large") {
+        UniqueBuffer<int64_t> buffer;
+        const size_t count = 3 * UniqueBuffer<int64_t>::kMmapThreshold / sizeof(int64_t);
+        for (size_t i = 0; i < count; ++i) {
+            buffer.PushBack(i);
+        }
+        REQUIRE(buffer.IsMapped());
+        REQUIRE(buffer.Capacity() * sizeof(int64_t) % 4096 == 0);
+        for (size_t i = 0; i < count; i += 1001) {
+            REQUIRE(buffer[i] == static_cast<int64_t>(i));
+        }
+        REQUIRE(buffer[count - 1] == static_cast<int64_t>(count - 1));
+    }
+
+    SECTION("Non-trivial elements") {
+        {
+            UniqueBuffer<MyInt> buffer;
+            for (int i = 0; i < 100; ++i) {
+                buffer.EmplaceBack(i);
+            }
+            REQUIRE(MyInt::AliveCount() == 100);
+            REQUIRE(buffer[42] == 42);
+            buffer.Resize(10);
+            REQUIRE(MyInt::AliveCount() == 10);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+
+        UniqueBuffer<std::string> strings(3);
+        strings[1] = "aba";
+        strings.PushBack("caba");
+        REQUIRE(strings[1] == "aba");
+        REQUIRE(strings[3] == "caba");
+    }
+
+    SECTION("Pushes its own element while full") {
+        UniqueBuffer<int> ints;
+        for (int i = 1; i <= 8; ++i) {
+            ints.PushBack(i);
+        }
+        REQUIRE(ints.Size() == ints.Capacity());
+        ints.PushBack(ints[0]);
+        REQUIRE(ints[8] == 1);
+
+        UniqueBuffer<int64_t> mapped;
+        mapped.Resize(UniqueBuffer<int64_t>::kMmapThreshold);
+        mapped[0] = 7;
+        while (mapped.Size() < mapped.Capacity()) {
+            mapped.PushBack(0);
+        }
+        mapped.PushBack(mapped[0]);
+        REQUIRE(mapped[mapped.Size() - 1] == 7);
+
+        UniqueBuffer<std::string> strings(8);
+        strings[0] = std::string(100, 'a');
+        REQUIRE(strings.Size() == strings.Capacity());
+        strings.PushBack(strings[0]);
+        REQUIRE(strings[8] == std::string(100, 'a'));
+    }
+
+    SECTION("Move") {
+        UniqueBuffer<int64_t> a;
+        a.Resize(UniqueBuffer<int64_t>::kMmapThreshold);
+        REQUIRE(a.IsMapped());
+
+        UniqueBuffer<int64_t> b(std::move(a));
+        REQUIRE(b.IsMapped());
+        REQUIRE(a.Size() == 0);
+        REQUIRE(!a.IsMapped());
+
+        a.PushBack(1);
+        REQUIRE(a[0] == 1);
+        b = std::move(a);
+        REQUIRE(b.Size() == 1);
+        REQUIRE(!b.IsMapped());
+    }
+
+    SECTION("Too large capacity") {
+        UniqueBuffer<int64_t> trivial;
+        trivial.PushBack(1);
+        REQUIRE_THROWS_AS(trivial.Reserve(SIZE_MAX / 4), std::length_error);
+        REQUIRE_THROWS_AS(trivial.Reserve(SIZE_MAX), std::length_error);
+        REQUIRE(trivial.Size() == 1);
+        REQUIRE(trivial[0] == 1);
+
+        UniqueBuffer<std::string> strings;
+        REQUIRE_THROWS_AS(strings.Reserve(SIZE_MAX / sizeof(std::string) + 1), std::length_error);
+        REQUIRE(strings.Capacity() == 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("UniqueBuffer vs std::vector appends", "[.bench]") {
+    constexpr size_t kCount = (size_t(1) << 30) / sizeof(int64_t);
+
+    ReportBench("std::vector::push_back up to 1 GiB", MeasureSeconds([] {
+                    std::vector<int64_t> vector;
+                    for (size_t i = 0; i < kCount; ++i) {
+                        vector.push_back(i);
+                    }
+                    DoNotOptimize(vector.back());
+                }));
+    ReportBench("UniqueBuffer::PushBack up to 1 GiB", MeasureSeconds([] {
+                    UniqueBuffer<int64_t> buffer;
+                    for (size_t i = 0; i < kCount; ++i) {
+                        buffer.PushBack(i);
+                    }
+                    DoNotOptimize(buffer[kCount - 1]);
+                }));
+}
@@ -0,0 +1,124 @@
+#include "../unique.h"
+#include "../handles.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool IsOpen(int fd) {
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+// Slot table handing out 32-bit indices
+struct SlotTable {
+    SlotIndex Take() {
+        used.push_back(true);
+        return SlotIndex(used.size() - 1);
+    }
+
+    std::vector<bool> used;
+};
+
+struct SlotDeleter {
+    using pointer = SlotIndex;
+
+    void operator()(SlotIndex index) const {
+        table->used[index.Get()] = false;
+    }
+
+    SlotTable* table = nullptr;
+};
+
+// Fancy pointer wrapping a raw one
+template <typename T>
+struct Fancy {
+    Fancy() = default;
+    Fancy(std::nullptr_t) {
+    }
+    explicit Fancy(T* ptr) : ptr(ptr) {
+    }
+    T& operator*() const {
+        return *ptr;
+    }
+    bool operator==(const Fancy& other) const = default;
+
+    T* ptr = nullptr;
+};
+
+struct FancyDeleter {
+    using pointer = Fancy<int>;
+
+    void operator()(Fancy<int> fancy) const {
+        delete fancy.ptr;
+    }
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Handle types") {
+    SECTION("No overhead") {
+        static_assert(sizeof(UniqueFd) == sizeof(int));
+        static_assert(std::is_same_v<UniqueFd::Pointer, FdHandle>);
+        static_assert(std::is_same_v<UniquePtr<int>::Pointer, int*>);
+        static_assert(NullableHandle<FdHandle>);
+    }
+
+    SECTION("File descriptors") {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        {
+            UniqueFd read_end(FdHandle{fds[0]});
+            UniqueFd write_end(FdHandle{fds[1]});
+            REQUIRE(read_end);
+            REQUIRE(read_end.Get().Get() == fds[0]);
+
+            UniqueFd moved(std::move(write_end));
+            REQUIRE(!write_end);
+            REQUIRE(write_end.Get().Get() == -1);
+            REQUIRE(IsOpen(fds[1]));
+
+            FdHandle raw = moved.Release();
+            REQUIRE(!moved);
+            REQUIRE(IsOpen(raw.Get()));
+            moved.Reset(raw);
+        }
+        REQUIRE(!IsOpen(fds[0]));
+        REQUIRE(!IsOpen(fds[1]));
+    }
+
+    SECTION("Descriptor 0 is not null") {
+        UniqueFd fd(FdHandle{0});
+        REQUIRE(fd);
+        fd.Release();
+    }
+
+    SECTION("Slot indices") {
+        SlotTable table;
+        {
+            UniquePtr<void, SlotDeleter> slot(table.Take(), SlotDeleter{&table});
+            UniquePtr<void, SlotDeleter> other(table.Take(), SlotDeleter{&table});
+            REQUIRE(other.Get().Get() == 1);
+            REQUIRE(table.used[0]);
+            slot = nullptr;
+            REQUIRE(!table.used[0]);
+        }
+        REQUIRE(!table.used[1]);
+    }
+
+    SECTION("Fancy pointers") {
+        UniquePtr<int, FancyDeleter> fancy(Fancy<int>(new int(42)));
+        REQUIRE(*fancy == 42);
+        fancy.Reset();
+        REQUIRE(!fancy);
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "unique.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Split `[0, n)` elements of `T`, laid out from a page-aligned address, into one range per
+// hardware thread, each covering whole pages. Elements are never split: a range starts at the
+// first element that starts at or after its first page, so an element straddling a page
+// boundary goes with the page it starts in. Ranges are never empty.
+template <typename T>
+std::vector<std::pair<size_t, size_t>> PageRanges(size_t n) {
+    constexpr size_t kPageSize = 4096;
+    const size_t pages = (n * sizeof(T) + kPageSize - 1) / kPageSize;
+    const size_t threads =
+        std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), pages);
+    // First element that starts at or after page `page`
+    auto first_on = [n](size_t page) {
+        return std::min(n, (page * kPageSize + sizeof(T) - 1) / sizeof(T));
+    };
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t t = 0; t < threads; ++t) {
+        size_t begin = first_on(pages * t / threads);
+        size_t end = first_on(pages * (t + 1) / threads);
+        if (begin < end) {
+            ranges.emplace_back(begin, end);
+        }
+    }
+    return ranges;
+}
+
+// Run `func(begin, end)` for every range on its own thread. Returns what each range threw
+// (null for the ones that finished). Ranges that could not get a thread run on the caller's.
+template <typename F>
+std::vector<std::exception_ptr> RunRangesParallel(
+    const std::vector<std::pair<size_t, size_t>>& ranges, F&& func) {
+    std::vector<std::exception_ptr> errors(ranges.size());
+    auto work = [&](size_t t) {
+        try {
+            func(ranges[t].first, ranges[t].second);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    // Nothing throws past this reservation: a thread that fails to start, for lack of
+    // resources or memory, leaves its range and the ones after it to the caller
+    std::vector<std::thread> workers;
+    workers.reserve(ranges.size());
+    size_t t = 1;
+    for (; t < ranges.size(); ++t) {
+        try {
+            workers.emplace_back(work, t);
+        } catch (...) {
+            break;
+        }
+    }
+    if (!ranges.empty()) {
+        work(0);
+    }
+    for (; t < ranges.size(); ++t) {
+        work(t);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return errors;
+}
+
+// Frees arrays made by `MakeUniqueArrayParallel`, running the destructors on all cores.
+// The element count lives in a page-sized cookie in front of the array, so that the array
+// itself starts on a page boundary.
+// Falls back to destroying on the calling thread if the ranges cannot even be set up.
+template <typename T>
+struct ParallelArrayDeleter {
+    static constexpr size_t kCookieSize = 4096;
+    static constexpr std::align_val_t kAlignment{kCookieSize};
+
+    void operator()(T* ptr) const noexcept {
+        char* memory = reinterpret_cast<char*>(ptr) - kCookieSize;
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            size_t n = *reinterpret_cast<size_t*>(memory);
+            try {
+                RunRangesParallel(PageRanges<T>(n), [ptr](size_t begin, size_t end) {
+                    Destroy(ptr, begin, end);
+                });
+            } catch (...) {
+                // Only the setup allocations throw, before any element is touched
+                Destroy(ptr, 0, n);
+            }
+        }
+        FreeMemory(memory);
+    }
+
+    static void FreeMemory(char* memory) noexcept {
+        ::operator delete[](memory, kAlignment);
+    }
+    // Owns the raw block while the array is being built
+    struct MemoryDeleter {
+        void operator()(char* memory) const noexcept {
+            FreeMemory(memory);
+        }
+    };
+
+    static void Destroy(T* ptr, size_t begin, size_t end) {
+        for (size_t i = end; i > begin; --i) {
+            ptr[i - 1].~T();
+        }
+    }
+};
+
+// Like `new T[n]`, but page faults and constructors are spread over all cores. Each page is
+// first touched by the thread that initialises it, so on NUMA machines it lands on that
+// thread's node. If a constructor throws, every element built so far is destroyed. Throws
+// `std::bad_array_new_length` if the array does not fit in `size_t` bytes.
+template <typename T, typename... Args>
+UniquePtr<T[], ParallelArrayDeleter<T>> MakeUniqueArrayParallel(size_t n, const Args&... args) {
+    using Deleter = ParallelArrayDeleter<T>;
+    static_assert(alignof(T) <= Deleter::kCookieSize);
+
+    if (n > (SIZE_MAX - Deleter::kCookieSize) / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+    UniquePtr<char, typename Deleter::MemoryDeleter> memory(static_cast<char*>(
+        ::operator new[](Deleter::kCookieSize + n * sizeof(T), Deleter::kAlignment)));
+    T* data = reinterpret_cast<T*>(memory.Get() + Deleter::kCookieSize);
+    *reinterpret_cast<size_t*>(memory.Get()) = n;
+
+    auto ranges = PageRanges<T>(n);
+    auto errors = RunRangesParallel(ranges, [data, &args...](size_t begin, size_t end) {
+        size_t i = begin;
+        try {
+            for (; i < end; ++i) {
+                new (data + i) T(args...);
+            }
+        } catch (...) {
+            Deleter::Destroy(data, begin, i);
+            throw;
+        }
+    });
+
+    auto failed =
+        std::find_if(errors.begin(), errors.end(), [](const auto& e) { return e != nullptr; });
+    if (failed == errors.end()) {
+        memory.Release();
+        return UniquePtr<T[], Deleter>(data);
+    }
+
+    // Failed ranges have unwound themselves, the finished ones are unwound here
+    for (size_t t = 0; t < ranges.size(); ++t) {
+        if (!errors[t]) {
+            Deleter::Destroy(data, ranges[t].first, ranges[t].second);
+        }
+    }
+    std::rethrow_exception(*failed);
+}
@@ -0,0 +1,152 @@
+#include "../unique.h"
+#include "../unique_parallel.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Counted {
+    Counted(int value = 0) : value(value) {
+        if (throw_at >= 0 && created.fetch_add(1) == throw_at) {
+            throw std::runtime_error("ctor");
+        }
+        alive++;
+    }
+    ~Counted() {
+        alive--;
+    }
+
+    int value;
+
+    inline static std::atomic<int> alive = 0;
+    inline static std::atomic<int> created = 0;
+    inline static int throw_at = -1;
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PageRanges") {
+    auto ranges = PageRanges<int>(1000000);
+    REQUIRE(ranges.front().first == 0);
+    REQUIRE(ranges.back().second == 1000000);
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        REQUIRE(ranges[i].first == ranges[i - 1].second);
+        REQUIRE(ranges[i].first * sizeof(int) % 4096 == 0);
+    }
+    REQUIRE(PageRanges<int>(0).empty());
+
+    // 4096 is not a multiple of 24: ranges start at the first element on a new page
+    struct Odd {
+        char bytes[24];
+    };
+    auto odd = PageRanges<Odd>(100000);
+    REQUIRE(odd.back().second == 100000);
+    for (size_t i = 1; i < odd.size(); ++i) {
+        REQUIRE(odd[i].first == odd[i - 1].second);
+        REQUIRE(odd[i].first * sizeof(Odd) % 4096 < sizeof(Odd));
+    }
+
+    struct Huge {
+        char bytes[10000];
+    };
+    for (auto [begin, end] : PageRanges<Huge>(3)) {
+        REQUIRE(begin < end);
+    }
+}
+
+TEST_CASE("RunRangesParallel") {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (size_t t = 0; t < 64; ++t) {
+        ranges.emplace_back(t * 10, t * 10 + 10);
+    }
+    std::vector<std::atomic<int>> runs(640);
+    auto errors = RunRangesParallel(ranges, [&runs](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            runs[i]++;
+        }
+        if (begin == 100) {
+            throw std::runtime_error("range");
+        }
+    });
+
+    for (auto& run : runs) {
+        REQUIRE(run == 1);
+    }
+    REQUIRE(errors.size() == 64);
+    REQUIRE(errors[10] != nullptr);
+    REQUIRE(errors[11] == nullptr);
+    STATIC_REQUIRE(noexcept(ParallelArrayDeleter<Counted>()(nullptr)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MakeUniqueArrayParallel") {
+    SECTION("Trivial elements") {
+        constexpr size_t kSize = 1 << 20;
+        auto array = MakeUniqueArrayParallel<int64_t>(kSize);
+        REQUIRE(reinterpret_cast<uintptr_t>(array.Get()) % 4096 == 0);
+        for (size_t i = 0; i < kSize; i += 4099) {
+            REQUIRE(array[i] == 0);
+        }
+        static_assert(sizeof(array) == sizeof(int64_t*));
+    }
+
+    SECTION("Constructor arguments and destructors") {
+        constexpr size_t kSize = 100000;
+        {
+            auto array = MakeUniqueArrayParallel<Counted>(kSize, 7);
+            REQUIRE(Counted::alive == kSize);
+            REQUIRE(array[0].value == 7);
+            REQUIRE(array[kSize - 1].value == 7);
+        }
+        REQUIRE(Counted::alive == 0);
+
+        auto strings = MakeUniqueArrayParallel<std::string>(10, "aba");
+        REQUIRE(strings[9] == "aba");
+    }
+
+    SECTION("Unwinds on exception") {
+        Counted::created = 0;
+        Counted::throw_at = 50000;
+        REQUIRE_THROWS_AS(MakeUniqueArrayParallel<Counted>(100000), std::runtime_error);
+        Counted::throw_at = -1;
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Empty") {
+        auto array = MakeUniqueArrayParallel<Counted>(0);
+        REQUIRE(array);
+    }
+
+    SECTION("Oversized") {
+        REQUIRE_THROWS_AS(MakeUniqueArrayParallel<int64_t>(SIZE_MAX / 4),
+                          std::bad_array_new_length);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("Parallel vs serial array", "[.bench]") {
+    constexpr size_t kSize = size_t(1) << 28;
+
+    ReportBench("new int64_t[]() 2 GiB", MeasureSeconds([] {
+                    UniquePtr<int64_t[]> array(new int64_t[kSize]());
+                    DoNotOptimize(array[kSize - 1]);
+                }));
+    ReportBench("MakeUniqueArrayParallel 2 GiB", MeasureSeconds([] {
+                    auto array = MakeUniqueArrayParallel<int64_t>(kSize);
+                    DoNotOptimize(array[kSize - 1]);
+                }));
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "compressed_pair.h"
+#include "unique.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// A copier turns `(object, deleter)` into a `UniquePtr<T, Deleter>` owning a copy, so the copy
+// is allocated the way that deleter frees it. The copiers below allocate with `new`: they pair
+// with deleters that `delete`, and other allocation schemes bring their own copier.
+
+// Copier that remembers how to copy the concrete type it was made for, so `ValuePtr<Base>`
+// can deep-copy a `Derived` without a virtual `Clone()`
+template <typename T>
+class ErasedCopier {
+public:
+    template <typename U>
+    static ErasedCopier For() {
+        ErasedCopier res;
+        res.copy_ = [](const T* ptr) -> T* { return new U(static_cast<const U&>(*ptr)); };
+        return res;
+    }
+
+    template <typename Deleter>
+    UniquePtr<T, Deleter> operator()(const T* ptr, const Deleter& deleter) const {
+        return UniquePtr<T, Deleter>(copy_(ptr), deleter);
+    }
+
+private:
+    T* (*copy_)(const T*) = nullptr;
+};
+
+// Stateless copier for values whose dynamic type is always `T`
+template <typename T>
+struct DefaultCopier {
+    template <typename U>
+    static DefaultCopier For() {
+        static_assert(std::is_same_v<T, U>, "DefaultCopier can't copy derived objects");
+        return {};
+    }
+
+    template <typename Deleter>
+    UniquePtr<T, Deleter> operator()(const T* ptr, const Deleter& deleter) const {
+        return UniquePtr<T, Deleter>(new T(*ptr), deleter);
+    }
+};
+
+// Owning pointer with value semantics: copying a `ValuePtr` copies the object it owns, and the
+// copy keeps a copy of the deleter. With a stateless copier and deleter it is as small as `T*`.
+template <typename T, typename Copier = ErasedCopier<T>, typename Deleter = std::default_delete<T>>
+class ValuePtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    ValuePtr() {
+    }
+    ValuePtr(std::nullptr_t) {
+    }
+    // `U` must be the dynamic type of the adopted object
+    template <typename U, typename Del2>
+    explicit ValuePtr(UniquePtr<U, Del2>&& owner)
+        : pair_(UniquePtr<T, Deleter>(std::move(owner)), Copier::template For<U>()) {
+    }
+
+    ValuePtr(const ValuePtr& other)
+        : pair_(other ? other.GetCopier()(other.Get(), other.GetDeleter())
+                      : UniquePtr<T, Deleter>(nullptr, other.GetDeleter()),
+                other.GetCopier()) {
+    }
+    ValuePtr(ValuePtr&& other) noexcept
+        : pair_(std::move(other.pair_.GetFirst()), std::move(other.pair_.GetSecond())) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    ValuePtr& operator=(const ValuePtr& other) {
+        if (this == &other) {
+            return *this;
+        }
+
+        ValuePtr copy(other);
+        Swap(copy);
+
+        return *this;
+    }
+    ValuePtr& operator=(ValuePtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+
+        pair_.GetFirst() = std::move(other.pair_.GetFirst());
+        pair_.GetSecond() = std::move(other.pair_.GetSecond());
+
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        pair_.GetFirst().Reset();
+    }
+    void Swap(ValuePtr& other) {
+        pair_.GetFirst().Swap(other.pair_.GetFirst());
+        std::swap(pair_.GetSecond(), other.pair_.GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return pair_.GetFirst().Get();
+    }
+    T& operator*() const {
+        return *Get();
+    }
+    T* operator->() const {
+        return Get();
+    }
+    explicit operator bool() const {
+        return Get() != nullptr;
+    }
+    const Copier& GetCopier() const {
+        return pair_.GetSecond();
+    }
+    const Deleter& GetDeleter() const {
+        return pair_.GetFirst().GetDeleter();
+    }
+
+private:
+    CompressedPair<UniquePtr<T, Deleter>, Copier> pair_;
+};
+
+template <typename T, typename U = T, typename Copier = ErasedCopier<T>, typename... Args>
+ValuePtr<T, Copier> MakeValue(Args&&... args) {
+    return ValuePtr<T, Copier>(UniquePtr<U>(new U(std::forward<Args>(args)...)));
+}
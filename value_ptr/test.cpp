@@ -0,0 +1,205 @@
+#include "../unique.h"
+#include "../value_ptr.h"
+#include "../bench.h"
+
+#include <catch.hpp>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Animal {
+    virtual ~Animal() = default;
+    virtual std::string Say() const = 0;
+};
+
+struct Cat : Animal {
+    std::string Say() const override {
+        return "meow " + name;
+    }
+
+    std::string name = "tom";
+};
+
+struct Dog : Animal {
+    std::string Say() const override {
+        return "woof";
+    }
+};
+
+struct Point {
+    int x = 0;
+    int y = 0;
+};
+
+// Baseline: the usual hand-written virtual `Clone()`
+struct Cloneable {
+    virtual ~Cloneable() = default;
+    virtual UniquePtr<Cloneable> Clone() const = 0;
+};
+
+struct Leaf : Cloneable {
+    UniquePtr<Cloneable> Clone() const override {
+        return UniquePtr<Cloneable>(new Leaf(*this));
+    }
+
+    int payload[4] = {};
+};
+
+struct CountingDeleter {
+    void operator()(Point* ptr) const {
+        ++*deleted;
+        delete ptr;
+    }
+
+    int* deleted;
+};
+
+// Copier and deleter pair for `malloc`-ed points
+struct MallocDeleter {
+    void operator()(Point* ptr) const {
+        ptr->~Point();
+        std::free(ptr);
+    }
+};
+
+struct MallocCopier {
+    template <typename U>
+    static MallocCopier For() {
+        return {};
+    }
+
+    template <typename Deleter>
+    UniquePtr<Point, Deleter> operator()(const Point* ptr, const Deleter& deleter) const {
+        return UniquePtr<Point, Deleter>(new (std::malloc(sizeof(Point))) Point(*ptr), deleter);
+    }
+};
+
+struct PlainLeaf {
+    virtual ~PlainLeaf() = default;
+};
+
+struct DerivedLeaf : PlainLeaf {
+    int payload[4] = {};
+};
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ValuePtr") {
+    SECTION("Sizes") {
+        static_assert(sizeof(ValuePtr<Point, DefaultCopier<Point>>) == sizeof(Point*));
+        static_assert(sizeof(ValuePtr<Animal>) == 2 * sizeof(void*));
+    }
+
+    SECTION("Deep copy keeps the dynamic type") {
+        ValuePtr<Animal> a = MakeValue<Animal, Cat>();
+        ValuePtr<Animal> b = a;
+        REQUIRE(b.Get() != a.Get());
+        REQUIRE(b->Say() == "meow tom");
+
+        static_cast<Cat&>(*b).name = "felix";
+        REQUIRE(a->Say() == "meow tom");
+        REQUIRE(b->Say() == "meow felix");
+
+        ValuePtr<Animal> c = MakeValue<Animal, Dog>();
+        c = b;
+        REQUIRE(c->Say() == "meow felix");
+        c = c;
+        REQUIRE(c->Say() == "meow felix");
+    }
+
+    SECTION("Move") {
+        auto a = MakeValue<Animal, Dog>();
+        Animal* raw = a.Get();
+        ValuePtr<Animal> b(std::move(a));
+        REQUIRE(!a);
+        REQUIRE(b.Get() == raw);
+
+        ValuePtr<Animal> c;
+        c = std::move(b);
+        REQUIRE(c.Get() == raw);
+
+        ValuePtr<Animal> d = c;
+        REQUIRE(d->Say() == "woof");
+    }
+
+    SECTION("Adopt UniquePtr") {
+        ValuePtr<Animal> a(UniquePtr<Cat>(new Cat));
+        auto b = a;
+        REQUIRE(b->Say() == "meow tom");
+    }
+
+    SECTION("Stateless copier") {
+        auto a = MakeValue<Point, Point, DefaultCopier<Point>>(Point{1, 2});
+        auto b = a;
+        b->x = 10;
+        REQUIRE(a->x == 1);
+        REQUIRE(b->x == 10);
+    }
+
+    SECTION("Copies keep the deleter") {
+        int deleted = 0;
+        ValuePtr<Point, DefaultCopier<Point>, CountingDeleter> a(
+            UniquePtr<Point, CountingDeleter>(new Point{1, 2}, CountingDeleter{&deleted}));
+        auto b = a;
+        REQUIRE(b.GetDeleter().deleted == &deleted);
+        REQUIRE(b->y == 2);
+        b.Reset();
+        REQUIRE(deleted == 1);
+        a = b;
+        REQUIRE(deleted == 2);
+    }
+
+    SECTION("Copier paired with the deleter") {
+        ValuePtr<Point, MallocCopier, MallocDeleter> a(
+            UniquePtr<Point, MallocDeleter>(new (std::malloc(sizeof(Point))) Point{3, 4}));
+        auto b = a;
+        b->x = 5;
+        REQUIRE(a->x == 3);
+        REQUIRE(b->x == 5);
+    }
+
+    SECTION("Null") {
+        ValuePtr<Animal> a;
+        ValuePtr<Animal> b = a;
+        REQUIRE(!b);
+        b = MakeValue<Animal, Dog>();
+        b.Reset();
+        REQUIRE(!b);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("ValuePtr vs virtual Clone", "[.bench]") {
+    constexpr int kCopies = 1 << 22;
+
+    UniquePtr<Cloneable> cloneable(new Leaf);
+    ReportBench("virtual Clone", MeasureSeconds([&] {
+                    for (int i = 0; i < kCopies; ++i) {
+                        auto copy = cloneable->Clone();
+                        DoNotOptimize(copy.Get());
+                    }
+                }));
+    auto value = MakeValue<PlainLeaf, DerivedLeaf>();
+    ReportBench("ValuePtr copy", MeasureSeconds([&] {
+                    for (int i = 0; i < kCopies; ++i) {
+                        auto copy = value;
+                        DoNotOptimize(copy.Get());
+                    }
+                }));
+    ReportBench("ValuePtr move", MeasureSeconds([&] {
+                    for (int i = 0; i < kCopies; ++i) {
+                        auto moved = std::move(value);
+                        value = std::move(moved);
+                    }
+                    DoNotOptimize(value.Get());
+                }));
+}
@@ -17,12 +17,12 @@ public:
     template <typename R>
     WeakPtr(const WeakPtr<R>& other) : block_(other.block_), ptr_(other.ptr_) {
         if (block_) {
-            block_->weak_++;
+            block_->AddWeak();
         }
     }
     WeakPtr(const WeakPtr& other) : block_(other.block_), ptr_(other.ptr_) {
         if (block_) {
-            block_->weak_++;
+            block_->AddWeak();
         }
     }
     WeakPtr(WeakPtr&& other) : block_(std::move(other.block_)), ptr_(std::move(other.ptr_)) {
@@ -39,13 +39,13 @@ public:
     // #2 from https://en.cppreference.com/w/cpp/memory/weak_ptr/weak_ptr
     WeakPtr(const SharedPtr<T>& other) : block_(other.block_), ptr_(other.ptr_) {
         if (block_) {
-            block_->weak_++;
+            block_->AddWeak();
         }
     }
     template<class P>
     WeakPtr(const SharedPtr<P>& other) : block_(other.block_), ptr_(other.ptr_) {
         if (block_) {
-            block_->weak_++;
+            block_->AddWeak();
         }
     }
 
@@ -61,7 +61,7 @@ public:
 
         block_ = other.block_;
         if (block_) {
-            block_->weak_++;
+            block_->AddWeak();
         }
         ptr_ = other.ptr_;
 
@@ -77,7 +77,7 @@ public:
 
         block_ = other.block_;
         if (block_) {
-            block_->weak_++;
+            block_->AddWeak();
         }
         ptr_ = other.ptr_;
 
@@ -129,7 +129,7 @@ public:
         if (block_) {
             block_->weak_--;
             if (block_->weak_ + block_->strong_ == 0) {
-                delete block_;
+                block_->Deallocate();
             }
         }
 